@@ -3,3 +3,199 @@
 
 #include "AbilitySystem/Attributes/RockAttributeChangeInfo.h"
 
+#include "GameplayEffect.h"
+#include "Logging/RockLogging.h"
+#include "Misc/ScopeLock.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Attribute Change Infos In Use"), STAT_RockAttributeChangeInfosInUse, STATGROUP_RockAbilitySystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Attribute Change Infos Pooled"), STAT_RockAttributeChangeInfosPooled, STATGROUP_RockAbilitySystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attribute Change Info Pool Misses"), STAT_RockAttributeChangeInfoPoolMisses, STATGROUP_RockAbilitySystem);
+
+const FGameplayTagContainer& FRockAttributeChangeInfo::GetSpecAssetTags() const
+{
+	if (!SpecAssetTagsSource)
+	{
+		return SpecAssetTags;
+	}
+
+	if (!bViewedSpecAssetTagsBuilt)
+	{
+		ViewedSpecAssetTags.Reset();
+		SpecAssetTagsSource->GetAllAssetTags(ViewedSpecAssetTags);
+		bViewedSpecAssetTagsBuilt = true;
+	}
+	return ViewedSpecAssetTags;
+}
+
+void FRockAttributeChangeInfo::ViewSpecTags(const FGameplayEffectSpec& EffectSpec)
+{
+	SourceTagsView = EffectSpec.CapturedSourceTags.GetAggregatedTags();
+	TargetTagsView = EffectSpec.CapturedTargetTags.GetAggregatedTags();
+	SpecAssetTagsSource = &EffectSpec;
+	bViewedSpecAssetTagsBuilt = false;
+}
+
+void FRockAttributeChangeInfo::MaterializeTags()
+{
+	if (SourceTagsView)
+	{
+		SourceTags = *SourceTagsView;
+		SourceTagsView = nullptr;
+	}
+	if (TargetTagsView)
+	{
+		TargetTags = *TargetTagsView;
+		TargetTagsView = nullptr;
+	}
+	if (SpecAssetTagsSource)
+	{
+		if (bViewedSpecAssetTagsBuilt)
+		{
+			SpecAssetTags = ViewedSpecAssetTags;
+		}
+		else
+		{
+			SpecAssetTagsSource->GetAllAssetTags(SpecAssetTags);
+		}
+		SpecAssetTagsSource = nullptr;
+		bViewedSpecAssetTagsBuilt = false;
+	}
+}
+
+void FRockAttributeChangeInfo::Reset()
+{
+	SourceTagsView = nullptr;
+	TargetTagsView = nullptr;
+	SpecAssetTagsSource = nullptr;
+	ViewedSpecAssetTags.Reset();
+	bViewedSpecAssetTagsBuilt = false;
+	Context.Clear();
+	SourceActor = nullptr;
+	TargetActor = nullptr;
+	SourceASC = nullptr;
+	TargetASC = nullptr;
+	SourceController = nullptr;
+	TargetController = nullptr;
+	SourceTags.Reset();
+	SpecAssetTags.Reset();
+	TargetTags.Reset();
+	SourceObject = nullptr;
+	DeltaMagnitude = 0.0f;
+}
+
+FRockAttributeChangeInfoPool::FRockAttributeChangeInfoPool(int32 InMaxPooledInfos)
+	: MaxPooledInfos(InMaxPooledInfos)
+{
+}
+
+FRockAttributeChangeInfoPool::~FRockAttributeChangeInfoPool()
+{
+	// Infos still in use hold a reference to the pool, so only free ones are left here
+	DEC_DWORD_STAT_BY(STAT_RockAttributeChangeInfosPooled, FreeEntries.Num());
+	for (FEntry* Entry : FreeEntries)
+	{
+		delete Entry;
+	}
+}
+
+FRockAttributeChangeInfoHandle FRockAttributeChangeInfoPool::Alloc()
+{
+	FEntry* Entry = nullptr;
+	{
+		FScopeLock ScopeLock(&FreeEntriesLock);
+		if (!FreeEntries.IsEmpty())
+		{
+			Entry = FreeEntries.Pop(EAllowShrinking::No);
+			DEC_DWORD_STAT(STAT_RockAttributeChangeInfosPooled);
+		}
+	}
+
+	if (!Entry)
+	{
+		Entry = new FEntry();
+		INC_DWORD_STAT(STAT_RockAttributeChangeInfoPoolMisses);
+	}
+
+	Entry->Pool = AsShared();
+	Entry->NumRefs.store(1, std::memory_order_relaxed);
+	INC_DWORD_STAT(STAT_RockAttributeChangeInfosInUse);
+	return FRockAttributeChangeInfoHandle(Entry);
+}
+
+void FRockAttributeChangeInfoPool::Release(FEntry* Entry)
+{
+	DEC_DWORD_STAT(STAT_RockAttributeChangeInfosInUse);
+	Entry->Info.Reset();
+
+	// Released after the lock below, this may be the last reference to the pool
+	const TSharedPtr<FRockAttributeChangeInfoPool, ESPMode::ThreadSafe> Pool = MoveTemp(Entry->Pool);
+	{
+		FScopeLock ScopeLock(&Pool->FreeEntriesLock);
+		if (Pool->FreeEntries.Num() < Pool->MaxPooledInfos)
+		{
+			Pool->FreeEntries.Push(Entry);
+			INC_DWORD_STAT(STAT_RockAttributeChangeInfosPooled);
+			return;
+		}
+	}
+
+	delete Entry;
+}
+
+FRockAttributeChangeInfoHandle::FRockAttributeChangeInfoHandle(const FRockAttributeChangeInfoHandle& Other)
+	: Entry(Other.Entry)
+{
+	if (Entry)
+	{
+		Entry->NumRefs.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+FRockAttributeChangeInfoHandle::FRockAttributeChangeInfoHandle(FRockAttributeChangeInfoHandle&& Other)
+	: Entry(Other.Entry)
+{
+	Other.Entry = nullptr;
+}
+
+FRockAttributeChangeInfoHandle::~FRockAttributeChangeInfoHandle()
+{
+	Reset();
+}
+
+FRockAttributeChangeInfoHandle& FRockAttributeChangeInfoHandle::operator=(const FRockAttributeChangeInfoHandle& Other)
+{
+	if (Entry != Other.Entry)
+	{
+		// Copy first, Other may only be kept alive by this handle
+		FRockAttributeChangeInfoHandle Copy(Other);
+		Reset();
+		Entry = Copy.Entry;
+		Copy.Entry = nullptr;
+	}
+	return *this;
+}
+
+FRockAttributeChangeInfoHandle& FRockAttributeChangeInfoHandle::operator=(FRockAttributeChangeInfoHandle&& Other)
+{
+	if (this != &Other)
+	{
+		Reset();
+		Entry = Other.Entry;
+		Other.Entry = nullptr;
+	}
+	return *this;
+}
+
+void FRockAttributeChangeInfoHandle::Reset()
+{
+	if (Entry)
+	{
+		FRockAttributeChangeInfoPool::FEntry* ReleasedEntry = Entry;
+		Entry = nullptr;
+		// The last reference returns the info, acquire-release so every write through other handles happens before its reset
+		if (ReleasedEntry->NumRefs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			FRockAttributeChangeInfoPool::Release(ReleasedEntry);
+		}
+	}
+}
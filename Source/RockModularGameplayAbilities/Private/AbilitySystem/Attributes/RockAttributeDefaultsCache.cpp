@@ -0,0 +1,206 @@
+// Copyright Broken Rock Studios LLC. All Rights Reserved.
+// See the LICENSE file for details.
+
+#include "AbilitySystem/Attributes/RockAttributeDefaultsCache.h"
+
+#include "Algo/AllOf.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Logging/RockLogging.h"
+#include "Memory/MemoryView.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+FArchive& operator<<(FArchive& Ar, FRockAttributeDefaultsCacheTable& Table)
+{
+	Ar << Table.SetIndex;
+	Ar << Table.NumSamples;
+	Ar << Table.NumRows;
+	Ar << Table.RowBySample;
+	Ar << Table.AttributeNames;
+	Ar << Table.AttributeNumSamples;
+	Ar << Table.ValueOffset;
+	return Ar;
+}
+
+bool FRockAttributeDefaultsCacheTable::HasValidRows() const
+{
+	if (NumRows < 0 || RowBySample.Num() != NumSamples)
+	{
+		return false;
+	}
+
+	for (const int32 Row : RowBySample)
+	{
+		if (Row < 0 || Row >= NumRows)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+FArchive& operator<<(FArchive& Ar, FRockAttributeDefaultsCacheGroup& Group)
+{
+	Ar << Group.GroupName;
+	Ar << Group.NumSamples;
+	Ar << Group.Tables;
+	return Ar;
+}
+
+FRockAttributeDefaultsCache::FRockAttributeDefaultsCache() = default;
+
+FRockAttributeDefaultsCache::~FRockAttributeDefaultsCache()
+{
+	// The region has to be released before the file handle it was mapped from
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FRockAttributeDefaultsCache::Save(const FString& Filename, uint64 SourceStamp, int32 SamplesPerLevel, const TArray<FString>& SetClassPaths, const TArray<FRockAttributeDefaultsCacheGroup>& Groups, TConstArrayView<float> Values)
+{
+	TArray<uint8> Directory;
+	FMemoryWriter DirectoryWriter(Directory);
+	DirectoryWriter << const_cast<TArray<FString>&>(SetClassPaths);
+	DirectoryWriter << const_cast<TArray<FRockAttributeDefaultsCacheGroup>&>(Groups);
+
+	// Magic, Version, SourceStamp, SamplesPerLevel, DirectorySize, NumValues, ValuesOffset
+	constexpr int64 HeaderSize = sizeof(uint32) * 2 + sizeof(uint64) + sizeof(int32) + sizeof(int64) * 3;
+
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	uint64 FileSourceStamp = SourceStamp;
+	int32 FileSamplesPerLevel = SamplesPerLevel;
+	int64 DirectorySize = Directory.Num();
+	int64 NumFileValues = Values.Num();
+	int64 ValuesOffset = Align(HeaderSize + DirectorySize, ValueAlignment);
+
+	TArray<uint8> Header;
+	FMemoryWriter HeaderWriter(Header);
+	HeaderWriter << FileMagic << FileVersion << FileSourceStamp << FileSamplesPerLevel << DirectorySize << NumFileValues << ValuesOffset;
+	check(Header.Num() == HeaderSize);
+
+	// Write next to the destination and move it over, so a crash never leaves a half written cache behind
+	const FString TempFilename = Filename + TEXT(".tmp");
+	TUniquePtr<FArchive> FileWriter(IFileManager::Get().CreateFileWriter(*TempFilename));
+	if (!FileWriter)
+	{
+		UE_LOG(LogRockAbilitySystem, Warning, TEXT("FRockAttributeDefaultsCache::Save Unable to write %s"), *TempFilename);
+		return false;
+	}
+
+	FileWriter->Serialize(Header.GetData(), Header.Num());
+	FileWriter->Serialize(Directory.GetData(), Directory.Num());
+
+	uint8 Padding[ValueAlignment] = {};
+	FileWriter->Serialize(Padding, ValuesOffset - Header.Num() - DirectorySize);
+	FileWriter->Serialize(const_cast<float*>(Values.GetData()), Values.Num() * sizeof(float));
+
+	const bool bWriteSucceeded = FileWriter->Close();
+	FileWriter.Reset();
+
+	if (!bWriteSucceeded || !IFileManager::Get().Move(*Filename, *TempFilename, true, true))
+	{
+		UE_LOG(LogRockAbilitySystem, Warning, TEXT("FRockAttributeDefaultsCache::Save Unable to write %s"), *Filename);
+		IFileManager::Get().Delete(*TempFilename);
+		return false;
+	}
+
+	UE_LOG(LogRockAbilitySystem, Log, TEXT("Saved attribute defaults cache %s (%d groups, %lld values)"), *Filename, Groups.Num(), NumFileValues);
+	return true;
+}
+
+bool FRockAttributeDefaultsCache::Load(const FString& Filename, uint64 SourceStamp, int32 SamplesPerLevel)
+{
+	if (!IFileManager::Get().FileExists(*Filename))
+	{
+		return false;
+	}
+
+	const uint8* FileData = nullptr;
+	int64 FileSize = 0;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	FOpenMappedResult MappedResult = PlatformFile.OpenMappedEx(*Filename);
+	if (MappedResult.HasValue())
+	{
+		MappedFile = MappedResult.StealValue();
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	}
+
+	if (MappedRegion)
+	{
+		FileData = MappedRegion->GetMappedPtr();
+		FileSize = MappedRegion->GetMappedSize();
+	}
+	else
+	{
+		MappedFile.Reset();
+		if (!FFileHelper::LoadFileToArray(LoadedBytes, *Filename))
+		{
+			return false;
+		}
+		FileData = LoadedBytes.GetData();
+		FileSize = LoadedBytes.Num();
+	}
+
+	FMemoryReaderView Reader(FMemoryView(FileData, FileSize));
+
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	uint64 FileSourceStamp = 0;
+	int32 FileSamplesPerLevel = 0;
+	int64 DirectorySize = 0;
+	int64 NumFileValues = 0;
+	int64 ValuesOffset = 0;
+	Reader << FileMagic << FileVersion << FileSourceStamp << FileSamplesPerLevel << DirectorySize << NumFileValues << ValuesOffset;
+
+	if (Reader.IsError() || FileMagic != Magic || FileVersion != Version)
+	{
+		UE_LOG(LogRockAbilitySystem, Log, TEXT("Attribute defaults cache %s has an unknown format, ignoring it"), *Filename);
+		return false;
+	}
+
+	if (FileSourceStamp != SourceStamp || FileSamplesPerLevel != SamplesPerLevel)
+	{
+		UE_LOG(LogRockAbilitySystem, Log, TEXT("Attribute defaults cache %s is stale, ignoring it"), *Filename);
+		return false;
+	}
+
+	if (ValuesOffset % ValueAlignment != 0 || ValuesOffset + NumFileValues * static_cast<int64>(sizeof(float)) > FileSize)
+	{
+		UE_LOG(LogRockAbilitySystem, Warning, TEXT("Attribute defaults cache %s is truncated, ignoring it"), *Filename);
+		return false;
+	}
+
+	Reader << SetClassPaths;
+	Reader << Groups;
+
+	const bool bValidRows = Algo::AllOf(Groups, [](const FRockAttributeDefaultsCacheGroup& Group)
+	{
+		return Algo::AllOf(Group.Tables, &FRockAttributeDefaultsCacheTable::HasValidRows);
+	});
+
+	if (Reader.IsError() || Reader.Tell() > ValuesOffset || !bValidRows)
+	{
+		UE_LOG(LogRockAbilitySystem, Warning, TEXT("Attribute defaults cache %s has a corrupt directory, ignoring it"), *Filename);
+		SetClassPaths.Reset();
+		Groups.Reset();
+		return false;
+	}
+
+	Values = reinterpret_cast<const float*>(FileData + ValuesOffset);
+	NumValues = NumFileValues;
+	return true;
+}
+
+TConstArrayView<float> FRockAttributeDefaultsCache::GetValues(int64 ValueOffset, int64 InNumValues) const
+{
+	if (ValueOffset < 0 || InNumValues < 0 || ValueOffset + InNumValues > NumValues)
+	{
+		return TConstArrayView<float>();
+	}
+	return TConstArrayView<float>(Values + ValueOffset, static_cast<int32>(InNumValues));
+}
@@ -7,6 +7,9 @@
 #include "AbilitySystem/Attributes/RockAttributeChangeInfo.h"
 #include "AbilitySystem/Components/RockAbilitySystemComponent.h"
 #include "AbilitySystem/Global/RockAbilitySystemGlobals.h"
+#include "Logging/RockLogging.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/StringBuilder.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(RockAttributeSet)
 
@@ -42,95 +45,204 @@ bool URockAttributeSet::ShouldInitProperty(bool FirstInit, FProperty* PropertyTo
 	return Super::ShouldInitProperty(FirstInit, PropertyToInit);
 }
 
-TSharedRef<FRockAttributeChangeInfo> URockAttributeSet::GetAttributeChangeInfoFromModData(const FGameplayEffectModCallbackData& Data) const
+void URockAttributeSet::BeginDestroy()
+{
+	if (CoalescedChangesEndFrameHandle.IsValid())
+	{
+		FCoreDelegates::OnEndFrame.Remove(CoalescedChangesEndFrameHandle);
+		CoalescedChangesEndFrameHandle.Reset();
+	}
+	PendingCoalescedChanges.Empty();
+
+	Super::BeginDestroy();
+}
+
+void URockAttributeSet::PostRepNotifies()
+{
+	Super::PostRepNotifies();
+
+	if (URockAbilitySystemComponent* RockAbilitySystemComponent = Cast<URockAbilitySystemComponent>(GetOwningAbilitySystemComponent()))
+	{
+		RockAbilitySystemComponent->FlushReplicatedAttributeChanges();
+	}
+}
+
+void URockAttributeSet::FlushCoalescedAttributeChanges()
+{
+	if (CoalescedChangesEndFrameHandle.IsValid())
+	{
+		FCoreDelegates::OnEndFrame.Remove(CoalescedChangesEndFrameHandle);
+		CoalescedChangesEndFrameHandle.Reset();
+	}
+
+	if (PendingCoalescedChanges.IsEmpty())
+	{
+		return;
+	}
+
+	// Listeners may change attributes again, which starts recording the next batch
+	const TArray<FRockCoalescedAttributeChange> Changes = MoveTemp(PendingCoalescedChanges);
+	PendingCoalescedChanges.Reset();
+	OnCoalescedAttributeChanges.Broadcast(this, Changes);
+}
+
+void URockAttributeSet::BroadcastAttributeEvent(const FRockAttributeEvent& Event, const FGameplayAttribute& Attribute, AActor* EffectInstigator, AActor* EffectCauser, const FGameplayEffectSpec* EffectSpec, float EffectMagnitude, float OldValue, float NewValue)
+{
+	Event.Broadcast(EffectInstigator, EffectCauser, EffectSpec, EffectMagnitude, OldValue, NewValue);
+	RecordCoalescedAttributeChange(Attribute, EffectInstigator, EffectMagnitude, OldValue, NewValue);
+}
+
+void URockAttributeSet::RecordCoalescedAttributeChange(const FGameplayAttribute& Attribute, AActor* EffectInstigator, float EffectMagnitude, float OldValue, float NewValue)
+{
+	if (!OnCoalescedAttributeChanges.IsBound())
+	{
+		return;
+	}
+
+	FRockCoalescedAttributeChange* Change = PendingCoalescedChanges.FindByPredicate([&Attribute](const FRockCoalescedAttributeChange& Pending)
+	{
+		return Pending.Attribute == Attribute;
+	});
+	if (!Change)
+	{
+		Change = &PendingCoalescedChanges.AddDefaulted_GetRef();
+		Change->Attribute = Attribute;
+		Change->OldValue = OldValue;
+	}
+
+	Change->NewValue = NewValue;
+	Change->TotalMagnitude += EffectMagnitude;
+	++Change->NumChanges;
+	if (EffectInstigator)
+	{
+		Change->Instigators.AddUnique(EffectInstigator);
+	}
+
+	if (!CoalescedChangesEndFrameHandle.IsValid())
+	{
+		CoalescedChangesEndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &ThisClass::FlushCoalescedAttributeChanges);
+	}
+}
+
+TSharedRef<FRockAttributeChangeInfo> URockAttributeSet::GetAttributeChangeInfoFromModData(const FGameplayEffectModCallbackData& Data, ERockAttributeChangeInfoTags TagCapture) const
 {
 	// Allocate a new instance of FRockAttributeChangeInfo.
-	const TSharedPtr<FRockAttributeChangeInfo> AttributeChangeInfo = URockAbilitySystemGlobals::Get().AllocRockAttributeChangeInfo();
-	
-	AttributeChangeInfo->Context = Data.EffectSpec.GetContext();
-	Data.EffectSpec.GetAllAssetTags(AttributeChangeInfo->SpecAssetTags);
+	TSharedRef<FRockAttributeChangeInfo> AttributeChangeInfo = URockAbilitySystemGlobals::Get().AllocRockAttributeChangeInfo().ToSharedRef();
+	FillAttributeChangeInfoFromModData(Data, TagCapture, *AttributeChangeInfo);
+	return AttributeChangeInfo;
+}
+
+FRockAttributeChangeInfoHandle URockAttributeSet::GetPooledAttributeChangeInfoFromModData(const FGameplayEffectModCallbackData& Data, ERockAttributeChangeInfoTags TagCapture) const
+{
+	FRockAttributeChangeInfoHandle AttributeChangeInfo = URockAbilitySystemGlobals::Get().AllocPooledRockAttributeChangeInfo();
+	FillAttributeChangeInfoFromModData(Data, TagCapture, *AttributeChangeInfo);
+	return AttributeChangeInfo;
+}
+
+void URockAttributeSet::FillAttributeChangeInfoFromModData(const FGameplayEffectModCallbackData& Data, ERockAttributeChangeInfoTags TagCapture, FRockAttributeChangeInfo& OutInfo) const
+{
+	OutInfo.Context = Data.EffectSpec.GetContext();
 	
 	// Set SourceASC (and note: consider how to handle non-Rock ASCs if needed)
-	AttributeChangeInfo->SourceASC = Cast<URockAbilitySystemComponent>(AttributeChangeInfo->Context.GetOriginalInstigatorAbilitySystemComponent());
+	OutInfo.SourceASC = Cast<URockAbilitySystemComponent>(OutInfo.Context.GetOriginalInstigatorAbilitySystemComponent());
 
-	if (AttributeChangeInfo->SourceASC && AttributeChangeInfo->SourceASC->AbilityActorInfo.IsValid())
+	if (OutInfo.SourceASC && OutInfo.SourceASC->AbilityActorInfo.IsValid())
 	{
 		// Prefer the effect causer if available; otherwise use the avatar actor.
-		if (AttributeChangeInfo->Context.GetEffectCauser())
+		if (OutInfo.Context.GetEffectCauser())
 		{
-			AttributeChangeInfo->SourceActor = AttributeChangeInfo->Context.GetEffectCauser();
+			OutInfo.SourceActor = OutInfo.Context.GetEffectCauser();
 		}
-		else if (AttributeChangeInfo->SourceASC->AbilityActorInfo->AvatarActor.IsValid())
+		else if (OutInfo.SourceASC->AbilityActorInfo->AvatarActor.IsValid())
 		{
-			AttributeChangeInfo->SourceActor = AttributeChangeInfo->SourceASC->AbilityActorInfo->AvatarActor.Get();
+			OutInfo.SourceActor = OutInfo.SourceASC->AbilityActorInfo->AvatarActor.Get();
 		}
 		else
 		{
-			AttributeChangeInfo->SourceActor = nullptr;
+			OutInfo.SourceActor = nullptr;
 		}
 		
-		AttributeChangeInfo->SourceController =AttributeChangeInfo->SourceASC->AbilityActorInfo->PlayerController.IsValid()
-			? AttributeChangeInfo->SourceASC->AbilityActorInfo->PlayerController.Get()
+		OutInfo.SourceController =OutInfo.SourceASC->AbilityActorInfo->PlayerController.IsValid()
+			? OutInfo.SourceASC->AbilityActorInfo->PlayerController.Get()
 			: nullptr;
 	}
 
 	if(Data.Target.AbilityActorInfo.IsValid())
 	{
-		AttributeChangeInfo->TargetActor = Data.Target.AbilityActorInfo->AvatarActor.IsValid()
+		OutInfo.TargetActor = Data.Target.AbilityActorInfo->AvatarActor.IsValid()
 			? Data.Target.AbilityActorInfo->AvatarActor.Get()
 			: nullptr;
-		AttributeChangeInfo->TargetController = Data.Target.AbilityActorInfo->PlayerController.Get();
+		OutInfo.TargetController = Data.Target.AbilityActorInfo->PlayerController.Get();
 	}
 	else
 	{
-		AttributeChangeInfo->TargetActor = nullptr;
-		AttributeChangeInfo->TargetController = nullptr;
+		OutInfo.TargetActor = nullptr;
+		OutInfo.TargetController = nullptr;
 	}
 	
 
 	// Gameplay Tags
-	AttributeChangeInfo->SourceTags = *Data.EffectSpec.CapturedSourceTags.GetAggregatedTags();
-	AttributeChangeInfo->TargetTags = *Data.EffectSpec.CapturedTargetTags.GetAggregatedTags();
+	OutInfo.ViewSpecTags(Data.EffectSpec);
+	if (TagCapture == ERockAttributeChangeInfoTags::Copy)
+	{
+		OutInfo.MaterializeTags();
+	}
 	
-	AttributeChangeInfo->SourceObject = Data.EffectSpec.GetEffectContext().GetSourceObject();
+	OutInfo.SourceObject = Data.EffectSpec.GetEffectContext().GetSourceObject();
 
 	// Set the delta magnitude based on the modifier operation.
-	AttributeChangeInfo->DeltaMagnitude = 0.0f;
+	OutInfo.DeltaMagnitude = 0.0f;
 	if (Data.EvaluatedData.ModifierOp == EGameplayModOp::Additive)
 	{
-		AttributeChangeInfo->DeltaMagnitude = Data.EvaluatedData.Magnitude;
+		OutInfo.DeltaMagnitude = Data.EvaluatedData.Magnitude;
 	}
 	// TODO: Handle other modifier operations (e.g., multiplicative) if needed.
-	
-	return AttributeChangeInfo.ToSharedRef();
 }
 
 void URockAttributeSet::AdjustAttributeForMaxChange(	const FGameplayAttributeData& AffectedAttribute, const FGameplayAttributeData& MaxAttribute, float NewMaxValue, const FGameplayAttribute& AffectedAttributeProperty) const
+{
+	// The max may live in any set, only its value is needed
+	RescaleAttributeBase(AffectedAttributeProperty, AffectedAttribute.GetCurrentValue(), MaxAttribute.GetCurrentValue(), NewMaxValue, true);
+}
+
+void URockAttributeSet::RescaleAttributeForMaxChange(const FGameplayAttribute& AffectedAttribute, const FGameplayAttribute& MaxAttribute, float NewMaxValue, bool bRoundToWhole) const
+{
+	const UAbilitySystemComponent* ASC = GetOwningAbilitySystemComponent();
+	if (!ASC || !ASC->HasAttributeSetForAttribute(AffectedAttribute) || !ASC->HasAttributeSetForAttribute(MaxAttribute))
+	{
+		return;
+	}
+
+	// Read through the ASC, the attributes don't have to belong to this set
+	RescaleAttributeBase(AffectedAttribute, ASC->GetNumericAttribute(AffectedAttribute), ASC->GetNumericAttribute(MaxAttribute), NewMaxValue, bRoundToWhole);
+}
+
+void URockAttributeSet::RescaleAttributeBase(const FGameplayAttribute& Attribute, float CurrentValue, float CurrentMaxValue, float NewMaxValue, bool bRoundToWhole) const
 {
 	UAbilitySystemComponent* ASC = GetOwningAbilitySystemComponent();
-	if (!ASC)
+	if (!ASC || !ASC->HasAttributeSetForAttribute(Attribute))
 	{
 		return;
 	}
-	
-	// cache current values
-	const float currentMaxValue = MaxAttribute.GetCurrentValue();
-	const float currentValue = AffectedAttribute.GetCurrentValue();
-	
-	if (FMath::IsNearlyEqual(currentMaxValue, NewMaxValue)  || currentMaxValue == 0.f)
+
+	if (FMath::IsNearlyEqual(CurrentMaxValue, NewMaxValue) || CurrentMaxValue == 0.f)
 	{
 		return;
 	}
-	// Change current value to maintain the current Value / Max percent
-	const float Ratio = currentValue / currentMaxValue;
-	
-	const float NewValue = FMath::RoundToFloat(Ratio *  NewMaxValue);
-	//- currentValue;
-	// LOG
 
-	ASC->ApplyModToAttribute(AffectedAttributeProperty, EGameplayModOp::Override, NewValue);
-	// I've seen in some instances, people using the Unsafe and Additive versions of this function. Consider using those if needed.
-	//	ASC->ApplyModToAttributeUnsafe(AffectedAttributeProperty, EGameplayModOp::Additive, NewDelta);
+	// Keep the current Value / Max percent
+	float NewValue = CurrentValue / CurrentMaxValue * NewMaxValue;
+	if (bRoundToWhole)
+	{
+		NewValue = FMath::RoundToFloat(NewValue);
+	}
+
+	if (FMath::IsNearlyEqual(NewValue, CurrentValue))
+	{
+		return;
+	}
+
+	ASC->SetNumericAttributeBase(Attribute, NewValue);
 }
 
 FName FRockAttributeInitializationKey::GetAttributeInitCategory() const
@@ -142,3 +254,15 @@ FName FRockAttributeInitializationKey::GetAttributeInitSubCategory() const
 {
 	return AttributeInitSubCategory;
 }
+
+FName FRockAttributeInitializationKey::GetAttributeInitGroupName() const
+{
+	if (AttributeInitSubCategory.IsNone())
+	{
+		return AttributeInitCategory;
+	}
+
+	TStringBuilder<256> GroupNameBuilder;
+	GroupNameBuilder << AttributeInitCategory << TEXT('.') << AttributeInitSubCategory;
+	return FName(GroupNameBuilder.ToView());
+}
@@ -5,9 +5,24 @@
 #include "AbilitySystem/Attributes/RockAttributeSetInitter.h"
 
 #include "AbilitySystemComponent.h"
+#include "Algo/AnyOf.h"
+#include "AbilitySystem/Attributes/RockAttributeDefaultsCache.h"
+#include "AbilitySystem/Components/RockAbilitySystemComponent.h"
 #include "AbilitySystemLog.h"
+#include "GameplayEffectAggregator.h"
+#include "Async/ParallelFor.h"
+#include "Engine/CurveTable.h"
+#include "Logging/RockLogging.h"
+#include "Misc/StringBuilder.h"
+#include "UObject/UObjectHash.h"
 
-TSubclassOf<UAttributeSet> CommonFindBestAttributeClass(TArray<TSubclassOf<UAttributeSet>>& ClassList, const FString& PartialName)
+#include <atomic>
+
+DECLARE_MEMORY_STAT(TEXT("Attribute Defaults Values"), STAT_RockAttributeDefaultsValueMemory, STATGROUP_RockAbilitySystem);
+DECLARE_MEMORY_STAT(TEXT("Attribute Defaults Saved By Row Sharing"), STAT_RockAttributeDefaultsMemorySaved, STATGROUP_RockAbilitySystem);
+DECLARE_MEMORY_STAT(TEXT("Attribute Defaults Lookups"), STAT_RockAttributeDefaultsLookupMemory, STATGROUP_RockAbilitySystem);
+
+TSubclassOf<UAttributeSet> CommonFindBestAttributeClass(const TArray<TSubclassOf<UAttributeSet>>& ClassList, const FString& PartialName)
 {
 	for (const TSubclassOf<UAttributeSet> Class : ClassList)
 	{
@@ -19,6 +34,87 @@ TSubclassOf<UAttributeSet> CommonFindBestAttributeClass(TArray<TSubclassOf<UAttr
 	return nullptr;
 }
 
+namespace RockAttributeSetInitter
+{
+	// Shared by all initters, keys caching a group index of a destroyed initter must never match a new one
+	static std::atomic<uint32> LastGeneration = 0;
+
+	// A single curve row resolved to its group, set and attribute, with one value per sample
+	struct FParsedAttributeRow
+	{
+		// Filled by the parallel parsing passes
+		const UCurveTable*			CurveTable = nullptr;
+		FName						RowName;
+		const FRealCurve*			Curve = nullptr;
+		FName						GroupName;
+		FName						SetName;
+		FName						AttributeName;
+		TSubclassOf<UAttributeSet>	Set;
+		FProperty*					Property = nullptr;
+		TArray<float>				Samples;
+		bool						bValid = false;
+
+		// Assigned by the serial merge, in row order so indices are deterministic
+		int32						GroupIndex = INDEX_NONE;
+		int32						SetIndex = INDEX_NONE;
+	};
+
+	/**
+	 * Splits "Group.Name.SetName.AttributeName" from the end without allocating strings.
+	 * The group is everything before the set name and may contain dots itself.
+	 */
+	bool SplitRowName(FName RowName, FName& OutGroupName, FName& OutSetName, FName& OutAttributeName)
+	{
+		TStringBuilder<256> RowNameBuilder;
+		RowName.AppendString(RowNameBuilder);
+		const FStringView RowView = RowNameBuilder.ToView();
+
+		int32 AttributeDot = INDEX_NONE;
+		if (!RowView.FindLastChar(TEXT('.'), AttributeDot))
+		{
+			return false;
+		}
+
+		const FStringView GroupAndSetView = RowView.Left(AttributeDot);
+		int32 SetDot = INDEX_NONE;
+		if (!GroupAndSetView.FindLastChar(TEXT('.'), SetDot))
+		{
+			return false;
+		}
+
+		const FStringView GroupView = GroupAndSetView.Left(SetDot);
+		const FStringView SetView = GroupAndSetView.RightChop(SetDot + 1);
+		const FStringView AttributeView = RowView.RightChop(AttributeDot + 1);
+		if (GroupView.IsEmpty() || SetView.IsEmpty() || AttributeView.IsEmpty())
+		{
+			return false;
+		}
+
+		OutGroupName = FName(GroupView.Len(), GroupView.GetData());
+		OutSetName = FName(SetView.Len(), SetView.GetData());
+		// Property names are always in the name table, so an unknown attribute name can't match a property anyway
+		OutAttributeName = FName(AttributeView.Len(), AttributeView.GetData(), FNAME_Find);
+		return true;
+	}
+}
+
+FRockAttributeSetInitter::FRockAttributeSetInitter(bool bInInterpolateLevels, int32 InSamplesPerLevel, bool bInWriteAttributesDirectly)
+	: bInterpolateLevels(bInInterpolateLevels)
+	, bWriteAttributesDirectly(bInWriteAttributesDirectly)
+	// Discrete levels only ever have the one sample per level
+	, SamplesPerLevel(bInInterpolateLevels ? FMath::Max(InSamplesPerLevel, 1) : 1)
+{
+	// Keys start at generation 0, so they resolve on first use even before any defaults are loaded
+	AdvanceGeneration();
+}
+
+FRockAttributeSetInitter::~FRockAttributeSetInitter() = default;
+
+void FRockAttributeSetInitter::AdvanceGeneration()
+{
+	Generation = ++RockAttributeSetInitter::LastGeneration;
+}
+
 void FRockAttributeSetInitter::PreloadAttributeSetData(const TArray<UCurveTable*>& CurveData)
 {
 	if (!ensure(CurveData.Num() > 0))
@@ -26,300 +122,1201 @@ void FRockAttributeSetInitter::PreloadAttributeSetData(const TArray<UCurveTable*
 		return;
 	}
 
+	GroupIndexByName.Reset();
+	Groups.Reset();
+	SetIndexByClass.Reset();
+	SetClasses.Reset();
+	Tables.Reset();
+	DefaultsCache.Reset();
+	AdvanceGeneration();
+
+	TArray<RockAttributeSetInitter::FParsedAttributeRow> ParsedRows;
+	ParseCurveTables(CurveData, ParsedRows);
+	BuildGroupTables(ParsedRows);
+}
+
+void FRockAttributeSetInitter::BuildGroupTables(TArray<RockAttributeSetInitter::FParsedAttributeRow>& ParsedRows)
+{
 	/**
-	 *	Get list of AttributeSet classes loaded
+	 *	Assign dense group and set indices in row order, so the result doesn't depend on how the parsing was scheduled
 	 */
-	TArray<TSubclassOf<UAttributeSet>> ClassList;
-	for (TObjectIterator<UClass> ClassIt; ClassIt; ++ClassIt)
+	TBitArray<> RebuiltGroups(false, Groups.Num());
+	for (RockAttributeSetInitter::FParsedAttributeRow& ParsedRow : ParsedRows)
 	{
-		UClass* TestClass = *ClassIt;
-		if (TestClass->IsChildOf(UAttributeSet::StaticClass()))
+		if (!ParsedRow.bValid)
+		{
+			continue;
+		}
+
+		int32& GroupIndex = GroupIndexByName.FindOrAdd(ParsedRow.GroupName, INDEX_NONE);
+		if (GroupIndex == INDEX_NONE)
+		{
+			GroupIndex = Groups.AddDefaulted();
+			Groups[GroupIndex].GroupName = ParsedRow.GroupName;
+			RebuiltGroups.Add(false);
+		}
+
+		int32& SetIndex = SetIndexByClass.FindOrAdd(*ParsedRow.Set, INDEX_NONE);
+		if (SetIndex == INDEX_NONE)
 		{
-			ClassList.Add(TestClass);
+			SetIndex = SetClasses.Add(ParsedRow.Set);
 		}
+
+		ParsedRow.GroupIndex = GroupIndex;
+		ParsedRow.SetIndex = SetIndex;
+		RebuiltGroups[GroupIndex] = true;
 	}
+	ParsedRows.RemoveAll([](const RockAttributeSetInitter::FParsedAttributeRow& ParsedRow) { return !ParsedRow.bValid; });
 
 	/**
-	 *	Loop through CurveData table and build sets of Defaults that keyed off of Name + Level
+	 *	Build the schema of every (group, set) table: its attributes and how many samples each of them defines.
+	 *	Groups that aren't part of these rows keep their tables, they only learn about newly added set classes.
 	 */
-	for (const UCurveTable* CurTable : CurveData)
+	for (int32 GroupIndex = 0; GroupIndex < Groups.Num(); ++GroupIndex)
 	{
-		for (const TPair<FName, FRealCurve*>& CurveRow : CurTable->GetRowMap())
+		FAttributeSetDefaultsGroup& Group = Groups[GroupIndex];
+		if (RebuiltGroups[GroupIndex])
 		{
-			FString RowName = CurveRow.Key.ToString();
-			FString ClassName;
-			FString SetName;
-			FString AttributeName;
-			FString Temp;
-
-			//Split the RowName into ClassName (Class) and the put the rest in Temp (Player.MaxHealth)
-			RowName.Split(TEXT("."), &Temp, &AttributeName, ESearchCase::IgnoreCase, ESearchDir::FromEnd);
-			//Split the remainder into the SetName (Player) and the AttributeName (MaxHealth)
-			Temp.Split(TEXT("."), &ClassName, &SetName, ESearchCase::IgnoreCase, ESearchDir::FromEnd);
-
-			//If some of these ended up unpopulated just disregard this row...
-			if (!ensure(!ClassName.IsEmpty() && !SetName.IsEmpty() && !AttributeName.IsEmpty()))
+			Group.TableIndexBySet.Init(INDEX_NONE, SetClasses.Num());
+			Group.ResolvedTableByClass.Reset();
+			Group.SourceTables.Reset();
+			Group.NumSamples = 0;
+		}
+		else
+		{
+			while (Group.TableIndexBySet.Num() < SetClasses.Num())
 			{
-				ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Unable to parse row %s in %s"), *RowName, *CurTable->GetName());
-				continue;
+				Group.TableIndexBySet.Add(INDEX_NONE);
 			}
+		}
+	}
 
-			// Find the AttributeSet
-
-			TSubclassOf<UAttributeSet> Set = CommonFindBestAttributeClass(ClassList, SetName);
-			if (!Set)
-			{
-				// This is ok, we may have rows in here that don't correspond directly to attributes
-				ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Unable to match AttributeSet from %s (row: %s)"), *SetName, *RowName);
-				continue;
-			}
+	const int32 FirstNewTableIndex = Tables.Num();
+	for (const RockAttributeSetInitter::FParsedAttributeRow& ParsedRow : ParsedRows)
+	{
+		FAttributeSetDefaultsGroup& Group = Groups[ParsedRow.GroupIndex];
+		Group.SourceTables.AddUnique(ParsedRow.CurveTable);
 
-			// Find the FProperty
-			// The IsSupportedProperty() just means "is this a number of a FGameplayAttribute?"
-			FProperty* Property = FindFProperty<FProperty>(*Set, *AttributeName);
-			if (!IsSupportedProperty(Property))
-			{
-				ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Unable to match Attribute from %s (row: %s)"), *AttributeName, *RowName);
-				continue;
-			}
+		int32& TableIndex = Group.TableIndexBySet[ParsedRow.SetIndex];
+		if (TableIndex == INDEX_NONE)
+		{
+			TableIndex = Tables.AddDefaulted();
+			Tables[TableIndex].SetClass = SetClasses[ParsedRow.SetIndex];
+			ABILITY_LOG(Verbose, TEXT("Initializing new default set for %s in group %s"), *SetClasses[ParsedRow.SetIndex]->GetName(), *Group.GroupName.ToString());
+		}
 
-			const FRealCurve* Curve = CurveRow.Value;
-			FName ClassFName = FName(*ClassName);
-			FAttributeSetDefaultsCollection& DefaultCollection = Defaults.FindOrAdd(ClassFName);
-
-			float FirstLevelFloat = 0.f;
-			float LastLevelFloat = 0.f;
-			Curve->GetTimeRange(FirstLevelFloat, LastLevelFloat);
-			int32 FirstLevel = FMath::RoundToInt32(FirstLevelFloat);
-			int32 LastLevel = FMath::RoundToInt32(LastLevelFloat);
-			
-			// Only log these as warnings, as they're not deal breakers.
-			if (FirstLevel != 1)
-			{
-				ABILITY_LOG(Warning, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData First level should be 1"));
-				// continue;
-			}
-			
-			// Check our curve to make sure the keys match the expected format
-			int32 ExpectedLevel = 1;
-			bool bShouldSkip = false;
-
-			// This whole for loop is just to check if the curve is valid.
-			// TODO: We could probably just skip this, once we support interpolation later. 
-			for (auto KeyIter = Curve->GetKeyHandleIterator(); KeyIter; ++KeyIter)
-			{
-				const FKeyHandle& KeyHandle = *KeyIter;
-				if (KeyHandle == FKeyHandle::Invalid())
-				{
-					ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Data contains an invalid key handle (row: %s)"), *RowName);
-					bShouldSkip = true;
-					break;
-				}
+		FAttributeSetDefaultsTable& Table = Tables[TableIndex];
+		const int32 NumRowSamples = ParsedRow.Samples.Num();
+		const int32 AttributeIndex = Table.Attributes.Find(ParsedRow.Property);
+		if (AttributeIndex == INDEX_NONE)
+		{
+			Table.Attributes.Add(ParsedRow.Property);
+			Table.AttributeNumSamples.Add(NumRowSamples);
+		}
+		else
+		{
+			Table.AttributeNumSamples[AttributeIndex] = FMath::Max(Table.AttributeNumSamples[AttributeIndex], NumRowSamples);
+		}
 
-				const int32 Level = Curve->GetKeyTimeValuePair(KeyHandle).Key;
-				if (ExpectedLevel != Level)
-				{
-					ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Keys are expected to start at 1 and increase by 1 for every key (row: %s)"), *RowName);
-					bShouldSkip = true;
-					break;
-				}
+		Table.NumSamples = FMath::Max(Table.NumSamples, NumRowSamples);
+		Group.NumSamples = FMath::Max(Group.NumSamples, NumRowSamples);
+	}
 
-				++ExpectedLevel;
-			}
+	/**
+	 *	Copy the curve values into the contiguous sample-major columns. Later rows for the same attribute override earlier ones.
+	 */
+	for (int32 TableIndex = FirstNewTableIndex; TableIndex < Tables.Num(); ++TableIndex)
+	{
+		FAttributeSetDefaultsTable& Table = Tables[TableIndex];
+		Table.ValueStorage.SetNumZeroed(Table.NumSamples * Table.Attributes.Num());
+		Table.Values = Table.ValueStorage;
+	}
 
-			if (bShouldSkip)
-			{
-				continue;
-			}
+	for (const RockAttributeSetInitter::FParsedAttributeRow& ParsedRow : ParsedRows)
+	{
+		FAttributeSetDefaultsTable& Table = Tables[Groups[ParsedRow.GroupIndex].TableIndexBySet[ParsedRow.SetIndex]];
+		const int32 AttributeIndex = Table.Attributes.Find(ParsedRow.Property);
+		const int32 NumAttributes = Table.Attributes.Num();
+		for (int32 SampleIndex = 0; SampleIndex < ParsedRow.Samples.Num(); ++SampleIndex)
+		{
+			Table.ValueStorage[SampleIndex * NumAttributes + AttributeIndex] = ParsedRow.Samples[SampleIndex];
+		}
+	}
 
-			// GetLastKeyHandle vs MaxTimeRange, we already defined LastLevel above.
-			LastLevel = Curve->GetKeyTime(Curve->GetLastKeyHandle());
-			DefaultCollection.LevelData.SetNum(FMath::Max(LastLevel, DefaultCollection.LevelData.Num()));
-			//At this point we know the Name of this "class"/"group", the AttributeSet, and the Property Name. Now loop through the values on the curve to get the attribute default value at each level.
-			// We should be iterating between Level 1 and LastLevel instead of KeyHandleIterator
-			for (auto KeyIter = Curve->GetKeyHandleIterator(); KeyIter; ++KeyIter)
-			{
-				const FKeyHandle& KeyHandle = *KeyIter;
+	for (int32 TableIndex = FirstNewTableIndex; TableIndex < Tables.Num(); ++TableIndex)
+	{
+		Tables[TableIndex].ShareSampleRows();
+		Tables[TableIndex].BuildLookups(SamplesPerLevel);
+	}
 
-				const TPair<float, float> LevelValuePair = Curve->GetKeyTimeValuePair(KeyHandle);
-				const int32 Level = LevelValuePair.Key;
-				const float Value = LevelValuePair.Value;
+	UpdateMemoryStats();
+}
 
-				FAttributeSetDefaults& SetDefaults = DefaultCollection.LevelData[Level - 1];
+void FRockAttributeSetInitter::UpdateMemoryStats() const
+{
+	int64 ValueBytes = 0;
+	int64 UnsharedValueBytes = 0;
+	// Everything derived from the values to speed up lookups, the changed attribute lists dominate
+	int64 LookupBytes = GroupIndexByName.GetAllocatedSize() + Groups.GetAllocatedSize() + SetIndexByClass.GetAllocatedSize()
+		+ SetClasses.GetAllocatedSize() + Tables.GetAllocatedSize();
+	for (const FAttributeSetDefaultsTable& Table : Tables)
+	{
+		// The per level columns are a second, unshared copy of the whole level values, so they count against the row sharing
+		ValueBytes += Table.Values.NumBytes() + Table.RowBySample.NumBytes() + Table.LevelColumns.GetAllocatedSize();
+		UnsharedValueBytes += static_cast<int64>(Table.NumSamples) * Table.Attributes.Num() * sizeof(float);
+		LookupBytes += Table.Attributes.GetAllocatedSize() + Table.AttributeNumSamples.GetAllocatedSize()
+			+ Table.AttributeIndexByProperty.GetAllocatedSize() + Table.GameplayAttributes.GetAllocatedSize()
+			+ Table.AttributeOffsets.GetAllocatedSize() + Table.NumericProperties.GetAllocatedSize()
+			+ Table.LevelColumnOffsets.GetAllocatedSize()
+			+ Table.ChangedAttributeOffsets.GetAllocatedSize() + Table.ChangedAttributes.GetAllocatedSize();
+	}
+	for (const FAttributeSetDefaultsGroup& Group : Groups)
+	{
+		LookupBytes += Group.TableIndexBySet.GetAllocatedSize() + Group.ResolvedTableByClass.GetAllocatedSize() + Group.SourceTables.GetAllocatedSize();
+	}
 
-				FAttributeDefaultValueList* DefaultDataList = SetDefaults.DataMap.Find(Set);
-				if (DefaultDataList == nullptr)
-				{
-					ABILITY_LOG(Verbose, TEXT("Initializing new default set for %s[%d]. PropertySize: %d.. DefaultSize: %d"), *Set->GetName(), Level, Set->GetPropertiesSize(), UAttributeSet::StaticClass()->GetPropertiesSize());
+	SET_MEMORY_STAT(STAT_RockAttributeDefaultsValueMemory, ValueBytes);
+	SET_MEMORY_STAT(STAT_RockAttributeDefaultsMemorySaved, UnsharedValueBytes - ValueBytes);
+	SET_MEMORY_STAT(STAT_RockAttributeDefaultsLookupMemory, LookupBytes);
+	ABILITY_LOG(Verbose, TEXT("Attribute defaults use %lld bytes of values and level columns, %lld bytes less than one row per sample, and %lld bytes of lookups"),
+		ValueBytes, UnsharedValueBytes - ValueBytes, LookupBytes);
+}
 
-					DefaultDataList = &SetDefaults.DataMap.Add(Set);
-				}
+void FRockAttributeSetInitter::FAttributeSetDefaultsTable::ShareSampleRows()
+{
+	// Consecutive samples with the same defaults, e.g. a flat stretch of levels, keep a single row
+	const int32 NumAttributes = Attributes.Num();
+	const SIZE_T RowBytes = NumAttributes * sizeof(float);
+	RowBySample.SetNumUninitialized(NumSamples);
 
-				// Import curve value into default data
+	int32 NumRows = 0;
+	for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+	{
+		const float* SampleValues = ValueStorage.GetData() + SampleIndex * NumAttributes;
+		if (NumRows > 0 && FMemory::Memcmp(SampleValues, ValueStorage.GetData() + (NumRows - 1) * NumAttributes, RowBytes) == 0)
+		{
+			RowBySample[SampleIndex] = NumRows - 1;
+			continue;
+		}
 
-				check(DefaultDataList);
-				DefaultDataList->AddPair(Property, Value);
-			}
+		if (NumRows != SampleIndex)
+		{
+			FMemory::Memmove(ValueStorage.GetData() + NumRows * NumAttributes, SampleValues, RowBytes);
 		}
+		RowBySample[SampleIndex] = NumRows++;
 	}
+
+	ValueStorage.SetNum(NumRows * NumAttributes);
+	ValueStorage.Shrink();
+	Values = ValueStorage;
 }
 
-void FRockAttributeSetInitter::InitAttributeSetDefaults(
-	UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, int32 Level, bool bInitialInit) const
+void FRockAttributeSetInitter::ReloadCurveTables(const TArray<UCurveTable*>& CurveData, const TArray<UCurveTable*>& ChangedTables, TArray<FName>& OutReloadedGroups)
 {
-	check(AbilitySystemComponent != nullptr);
-
-	// This whole block will look if the provided group exists in the preloaded data.
-	// If it doesn't it checks for the Default group. If that isn't there either, the whole operation is stopped.
-	const FAttributeSetDefaultsCollection* Collection = Defaults.Find(GroupName);
-	if (!Collection)
+	OutReloadedGroups.Reset();
+	if (DefaultsCache || Groups.IsEmpty())
 	{
-		ABILITY_LOG(Error, TEXT("Unable to find DefaultAttributeSet Group %s. Falling back to Defaults"), *GroupName.ToString());
-		Collection = Defaults.Find(FName(TEXT("Default")));
-		if (!Collection)
+		// Groups loaded from the cache don't know their source tables, preload everything instead
+		PreloadAttributeSetData(CurveData);
+		for (const FAttributeSetDefaultsGroup& Group : Groups)
 		{
-			ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::InitAttributeSetDefaults Default DefaultAttributeSet not found! Skipping Initialization"));
-			return;
+			OutReloadedGroups.Add(Group.GroupName);
 		}
-	}
-
-	if (!Collection->LevelData.IsValidIndex(Level - 1))
-	{
-		// We could eventually extrapolate values outside the max defined levels
-		ABILITY_LOG(Error, TEXT("Init Attribute defaults for Level %d are not defined! Skipping"), Level);
 		return;
 	}
-	
-	const FAttributeSetDefaults& SetDefaults = Collection->LevelData[Level - 1];
-	// Iterate over all the spawned attribute sets of the provided ASC
-	for (const UAttributeSet* Set : AbilitySystemComponent->GetSpawnedAttributes())
+
+	/**
+	 *	The affected groups are the ones the changed tables used to feed and the ones they feed now.
+	 *	Every table feeding one of those groups has to be parsed again, as rows of later tables override earlier ones.
+	 */
+	TArray<RockAttributeSetInitter::FParsedAttributeRow> ChangedRows;
+	ParseCurveTables(ChangedTables, ChangedRows);
+
+	TSet<FName> AffectedGroupNames;
+	for (const RockAttributeSetInitter::FParsedAttributeRow& ParsedRow : ChangedRows)
 	{
-		if (!Set)
+		if (ParsedRow.bValid)
 		{
-			continue;
+			AffectedGroupNames.Add(ParsedRow.GroupName);
 		}
-		// Iterate to find the parent classes, as this could be a derived set
-		TSubclassOf<UAttributeSet> ParentClass;
-		for (ParentClass = Set->GetClass(); ParentClass ? ParentClass->GetSuperClass() : nullptr; ParentClass = ParentClass->GetSuperClass())
+	}
+
+	for (const FAttributeSetDefaultsGroup& Group : Groups)
+	{
+		for (const UCurveTable* ChangedTable : ChangedTables)
 		{
-			if (SetDefaults.DataMap.Contains(ParentClass))
+			if (Group.SourceTables.Contains(ChangedTable))
 			{
-				ABILITY_LOG(Log, TEXT("Found Parent Class %s"), *ParentClass->GetName());
+				AffectedGroupNames.Add(Group.GroupName);
 				break;
 			}
 		}
-		// Check our preloaded data to see if we have any curves for the given attribute set...
-		const FAttributeDefaultValueList* DefaultDataList = SetDefaults.DataMap.Find(ParentClass);
-		if (DefaultDataList)
+	}
+
+	TArray<UCurveTable*> TablesToParse;
+	for (UCurveTable* CurveTable : CurveData)
+	{
+		bool bFeedsAffectedGroup = ChangedTables.Contains(CurveTable);
+		for (int32 GroupIndex = 0; GroupIndex < Groups.Num() && !bFeedsAffectedGroup; ++GroupIndex)
+		{
+			bFeedsAffectedGroup = AffectedGroupNames.Contains(Groups[GroupIndex].GroupName) && Groups[GroupIndex].SourceTables.Contains(CurveTable);
+		}
+
+		if (bFeedsAffectedGroup)
+		{
+			TablesToParse.Add(CurveTable);
+		}
+	}
+
+	TArray<RockAttributeSetInitter::FParsedAttributeRow> ParsedRows;
+	ParseCurveTables(TablesToParse, ParsedRows);
+	ParsedRows.RemoveAll([&AffectedGroupNames](const RockAttributeSetInitter::FParsedAttributeRow& ParsedRow) { return !AffectedGroupNames.Contains(ParsedRow.GroupName); });
+
+	// Affected groups that no longer have any rows are emptied
+	for (FAttributeSetDefaultsGroup& Group : Groups)
+	{
+		if (AffectedGroupNames.Contains(Group.GroupName))
 		{
-			ABILITY_LOG(Log, TEXT("Initializing Set %s"), *Set->GetName());
+			Group.TableIndexBySet.Init(INDEX_NONE, SetClasses.Num());
+			Group.ResolvedTableByClass.Reset();
+			Group.SourceTables.Reset();
+			Group.NumSamples = 0;
+		}
+	}
+
+	BuildGroupTables(ParsedRows);
+	CompactTables();
+	UpdateMemoryStats();
+
+	// Keys that fell back to the "Default" group may have a group of their own now
+	AdvanceGeneration();
+
+	OutReloadedGroups = AffectedGroupNames.Array();
+	ABILITY_LOG(Log, TEXT("Reloaded %d attribute default groups from %d curve tables"), OutReloadedGroups.Num(), TablesToParse.Num());
+}
+
+void FRockAttributeSetInitter::CompactTables()
+{
+	TArray<int32> NewTableIndices;
+	NewTableIndices.Init(INDEX_NONE, Tables.Num());
 
-			for (auto& DataPair : DefaultDataList->List)
+	TArray<FAttributeSetDefaultsTable> ReferencedTables;
+	ReferencedTables.Reserve(Tables.Num());
+	for (FAttributeSetDefaultsGroup& Group : Groups)
+	{
+		for (int32& TableIndex : Group.TableIndexBySet)
+		{
+			if (TableIndex == INDEX_NONE)
 			{
-				check(DataPair.Property);
+				continue;
+			}
 
-				if (Set->ShouldInitProperty(bInitialInit, DataPair.Property))
-				{
-					FGameplayAttribute AttributeToModify(DataPair.Property);
-					AbilitySystemComponent->SetNumericAttributeBase(AttributeToModify, DataPair.Value);
-				}
+			if (NewTableIndices[TableIndex] == INDEX_NONE)
+			{
+				NewTableIndices[TableIndex] = ReferencedTables.Add(MoveTemp(Tables[TableIndex]));
+			}
+			TableIndex = NewTableIndices[TableIndex];
+		}
+
+		for (TPair<TObjectKey<UClass>, int32>& ResolvedTable : Group.ResolvedTableByClass)
+		{
+			if (ResolvedTable.Value != INDEX_NONE)
+			{
+				ResolvedTable.Value = NewTableIndices[ResolvedTable.Value];
 			}
 		}
 	}
 
-	AbilitySystemComponent->ForceReplication();
+	Tables = MoveTemp(ReferencedTables);
 }
 
-void FRockAttributeSetInitter::ApplyAttributeDefault(
-	UAbilitySystemComponent* AbilitySystemComponent, FGameplayAttribute& InAttribute, FName GroupName, int32 Level) const
+void FRockAttributeSetInitter::ParseCurveTables(const TArray<UCurveTable*>& CurveData, TArray<RockAttributeSetInitter::FParsedAttributeRow>& OutParsedRows) const
 {
-	// This is same as AttributeSetInitterDiscreteLevels 
-	
-	//SCOPE_CYCLE_COUNTER(STAT_InitAttributeSetDefaults);
-	const FAttributeSetDefaultsCollection* Collection = Defaults.Find(GroupName);
-	if (!Collection)
+	using RockAttributeSetInitter::FParsedAttributeRow;
+
+	/**
+	 *	Get list of AttributeSet classes loaded, sorted by name so partial name matches are deterministic
+	 */
+	TArray<UClass*> DerivedClasses;
+	GetDerivedClasses(UAttributeSet::StaticClass(), DerivedClasses, true);
+
+	TArray<TSubclassOf<UAttributeSet>> ClassList;
+	TMap<FName, TSubclassOf<UAttributeSet>> ClassByName;
+	ClassList.Reserve(DerivedClasses.Num());
+	ClassByName.Reserve(DerivedClasses.Num());
+	for (UClass* DerivedClass : DerivedClasses)
+	{
+		ClassList.Add(DerivedClass);
+		ClassByName.Add(DerivedClass->GetFName(), DerivedClass);
+	}
+	ClassList.Sort([](const TSubclassOf<UAttributeSet>& A, const TSubclassOf<UAttributeSet>& B) { return A->GetFName().LexicalLess(B->GetFName()); });
+
+	/**
+	 *	Flatten every row of every table, in table order
+	 */
+	int32 NumRows = 0;
+	for (const UCurveTable* CurTable : CurveData)
+	{
+		NumRows += CurTable->GetRowMap().Num();
+	}
+
+	OutParsedRows.Reset(NumRows);
+	for (const UCurveTable* CurTable : CurveData)
 	{
-		ABILITY_LOG(Error, TEXT("Unable to find DefaultAttributeSet Group %s. Falling back to Defaults"), *GroupName.ToString());
-		Collection = Defaults.Find(FName(TEXT("Default")));
-		if (!Collection)
+		for (const TPair<FName, FRealCurve*>& CurveRow : CurTable->GetRowMap())
 		{
-			ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::InitAttributeSetDefaults Default DefaultAttributeSet not found! Skipping Initialization"));
-			return;
+			FParsedAttributeRow& ParsedRow = OutParsedRows.AddDefaulted_GetRef();
+			ParsedRow.CurveTable = CurTable;
+			ParsedRow.RowName = CurveRow.Key;
+			ParsedRow.Curve = CurveRow.Value;
 		}
 	}
 
-	if (!Collection->LevelData.IsValidIndex(Level - 1))
+	/**
+	 *	Split all row names in parallel. Group.Name.SetName.AttributeName
+	 */
+	ParallelFor(OutParsedRows.Num(), [&OutParsedRows](int32 RowIndex)
 	{
-		// We could eventually extrapolate values outside the max defined levels
-		ABILITY_LOG(Error, TEXT("Attribute defaults for Level %d are not defined! Skipping"), Level);
-		return;
-	}
+		FParsedAttributeRow& ParsedRow = OutParsedRows[RowIndex];
+		ParsedRow.bValid = RockAttributeSetInitter::SplitRowName(ParsedRow.RowName, ParsedRow.GroupName, ParsedRow.SetName, ParsedRow.AttributeName);
+		if (!ParsedRow.bValid)
+		{
+			//If some of these ended up unpopulated just disregard this row...
+			ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Unable to parse row %s in %s"), *ParsedRow.RowName.ToString(), *ParsedRow.CurveTable->GetName());
+		}
+	});
 
-	const FAttributeSetDefaults& SetDefaults = Collection->LevelData[Level - 1];
-	for (const UAttributeSet* Set : AbilitySystemComponent->GetSpawnedAttributes())
+	/**
+	 *	Resolve the AttributeSet of every distinct set name once. Exact class names win over partial matches
+	 */
+	TMap<FName, TSubclassOf<UAttributeSet>> SetBySetName;
+	for (FParsedAttributeRow& ParsedRow : OutParsedRows)
 	{
-		if (!Set)
+		if (!ParsedRow.bValid)
 		{
 			continue;
 		}
 
-		// Iterate to find the parent classes, as this could be a derived set
-		TSubclassOf<UAttributeSet> ParentClass;
-		for (ParentClass = Set->GetClass(); ParentClass ? ParentClass->GetSuperClass() : nullptr; ParentClass = ParentClass->GetSuperClass())
+		TSubclassOf<UAttributeSet>* Set = SetBySetName.Find(ParsedRow.SetName);
+		if (!Set)
 		{
-			if (SetDefaults.DataMap.Contains(ParentClass))
+			TSubclassOf<UAttributeSet> FoundSet = ClassByName.FindRef(ParsedRow.SetName);
+			if (!FoundSet)
 			{
-				break;
+				FoundSet = CommonFindBestAttributeClass(ClassList, ParsedRow.SetName.ToString());
 			}
+			Set = &SetBySetName.Add(ParsedRow.SetName, FoundSet);
 		}
 
-		const FAttributeDefaultValueList* DefaultDataList = SetDefaults.DataMap.Find(ParentClass);
-		if (DefaultDataList)
+		ParsedRow.Set = *Set;
+		if (!ParsedRow.Set)
 		{
-			ABILITY_LOG(Log, TEXT("Initializing Set %s"), *Set->GetName());
+			// This is ok, we may have rows in here that don't correspond directly to attributes
+			ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Unable to match AttributeSet from %s (row: %s)"), *ParsedRow.SetName.ToString(), *ParsedRow.RowName.ToString());
+			ParsedRow.bValid = false;
+		}
+	}
 
-			for (auto& DataPair : DefaultDataList->List)
-			{
-				check(DataPair.Property);
+	/**
+	 *	Find the properties and sample the curves in parallel, every row only touches its own entry
+	 */
+	ParallelFor(OutParsedRows.Num(), [this, &OutParsedRows](int32 RowIndex)
+	{
+		FParsedAttributeRow& ParsedRow = OutParsedRows[RowIndex];
+		if (!ParsedRow.bValid)
+		{
+			return;
+		}
 
-				if (DataPair.Property == InAttribute.GetUProperty())
-				{
-					FGameplayAttribute AttributeToModify(DataPair.Property);
-					AbilitySystemComponent->SetNumericAttributeBase(AttributeToModify, DataPair.Value);
-				}
-			}
+		// Find the FProperty
+		// The IsSupportedProperty() just means "is this a number of a FGameplayAttribute?"
+		ParsedRow.Property = ParsedRow.AttributeName.IsNone() ? nullptr : FindFProperty<FProperty>(*ParsedRow.Set, ParsedRow.AttributeName);
+		if (!IsSupportedProperty(ParsedRow.Property))
+		{
+			ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Unable to match Attribute (row: %s)"), *ParsedRow.RowName.ToString());
+			ParsedRow.bValid = false;
+			return;
 		}
-	}
 
-	AbilitySystemComponent->ForceReplication();
+		ParsedRow.bValid = SampleCurve(ParsedRow.Curve, ParsedRow.RowName, ParsedRow.Samples);
+	});
 }
 
-TArray<float> FRockAttributeSetInitter::GetAttributeSetValues(UClass* AttributeSetClass, FProperty* AttributeProperty, FName GroupName) const
+bool FRockAttributeSetInitter::SampleCurve(const FRealCurve* Curve, FName RowName, TArray<float>& OutSamples) const
 {
-	TArray<float> AttributeSetValues;
-	const FAttributeSetDefaultsCollection* Collection = Defaults.Find(GroupName);
-	if (!Collection)
+	for (auto KeyIter = Curve->GetKeyHandleIterator(); KeyIter; ++KeyIter)
 	{
-		ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::InitAttributeSetDefaults Default DefaultAttributeSet not found! Skipping Initialization"));
-		return TArray<float>();
+		if (*KeyIter == FKeyHandle::Invalid())
+		{
+			ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Data contains an invalid key handle (row: %s)"), *RowName.ToString());
+			return false;
+		}
 	}
 
-	for (const FAttributeSetDefaults& SetDefaults : Collection->LevelData)
+	if (bInterpolateLevels)
 	{
-		const FAttributeDefaultValueList* DefaultDataList = SetDefaults.DataMap.Find(AttributeSetClass);
-		if (DefaultDataList)
+		if (Curve->GetNumKeys() == 0)
 		{
-			for (auto& DataPair : DefaultDataList->List)
-			{
-				check(DataPair.Property);
-				if (DataPair.Property == AttributeProperty)
-				{
-					AttributeSetValues.Add(DataPair.Value);
-				}
-			}
+			ABILITY_LOG(Error, TEXT("FRockAttributeSetInitter::PreloadAttributeSetData Curve has no keys (row: %s)"), *RowName.ToString());
+			return false;
+		}
+
+		// Sample from level 1 up to the last key, anything before the first key is extrapolated by the curve itself
+		const float LastLevel = Curve->GetKeyTime(Curve->GetLastKeyHandle());
+		const int32 NumSamples = FMath::Max(FMath::FloorToInt32((LastLevel - 1.f) * SamplesPerLevel) + 1, 1);
+		OutSamples.SetNumUninitialized(NumSamples);
+		for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+		{
+			OutSamples[SampleIndex] = Curve->Eval(1.f + static_cast<float>(SampleIndex) / SamplesPerLevel);
+		}
+		return true;
+	}
+
+	float FirstLevelFloat = 0.f;
+	float LastLevelFloat = 0.f;
+	Curve->GetTimeRange(FirstLevelFloat, LastLevelFloat);
+	int32 FirstLevel = FMath::RoundToInt32(FirstLevelFloat);
+	
+	// Only log these as warnings, as they're not deal breakers.
+	if (FirstLevel != 1)
+	{
+		ABILITY_LOG(Warning, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData First level should be 1"));
+		// continue;
+	}
+	
+	// Check our curve to make sure the keys match the expected format
+	int32 ExpectedLevel = 1;
+	OutSamples.Reset(Curve->GetNumKeys());
+	for (auto KeyIter = Curve->GetKeyHandleIterator(); KeyIter; ++KeyIter)
+	{
+		const TPair<float, float> LevelValuePair = Curve->GetKeyTimeValuePair(*KeyIter);
+		const int32 Level = LevelValuePair.Key;
+		if (ExpectedLevel != Level)
+		{
+			ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::PreloadAttributeSetData Keys are expected to start at 1 and increase by 1 for every key (row: %s)"), *RowName.ToString());
+			return false;
 		}
+
+		// Keys are 1, 2, 3... so the key index is the sample index
+		OutSamples.Add(LevelValuePair.Value);
+		++ExpectedLevel;
+	}
+	return true;
+}
+
+bool FRockAttributeSetInitter::FindSamplePosition(const FAttributeSetDefaultsGroup& Group, float Level, int32& OutSampleIndex, float& OutAlpha) const
+{
+	const float SamplePosition = (Level - 1.f) * SamplesPerLevel;
+	if (SamplePosition < 0.f)
+	{
+		return false;
+	}
+
+	OutSampleIndex = FMath::FloorToInt32(SamplePosition);
+	OutAlpha = SamplePosition - OutSampleIndex;
+	return OutSampleIndex < Group.NumSamples;
+}
+
+int32 FRockAttributeSetInitter::FindGroupIndexWithFallback(FName GroupName) const
+{
+	// This whole block will look if the provided group exists in the preloaded data.
+	// If it doesn't it checks for the Default group. If that isn't there either, the whole operation is stopped.
+	const int32 GroupIndex = FindResolvedGroupIndex(GroupName);
+	if (GroupIndex != INDEX_NONE)
+	{
+		return GroupIndex;
+	}
+
+	ABILITY_LOG(Error, TEXT("Unable to find DefaultAttributeSet Group %s. Falling back to Defaults"), *GroupName.ToString());
+	const int32 DefaultGroupIndex = FindResolvedGroupIndex(FName(TEXT("Default")));
+	if (DefaultGroupIndex != INDEX_NONE)
+	{
+		return DefaultGroupIndex;
 	}
-	return AttributeSetValues;
+
+	ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::InitAttributeSetDefaults Default DefaultAttributeSet not found! Skipping Initialization"));
+	return INDEX_NONE;
+}
+
+int32 FRockAttributeSetInitter::ResolveGroupIndex(FName GroupName, bool& bOutIsFallback) const
+{
+	const int32 GroupIndex = FindResolvedGroupIndex(GroupName);
+	bOutIsFallback = GroupIndex == INDEX_NONE;
+	return bOutIsFallback ? FindGroupIndexWithFallback(GroupName) : GroupIndex;
+}
+
+int32 FRockAttributeSetInitter::FindResolvedGroupIndex(FName GroupName) const
+{
+	// Groups loaded from the cache are all resolved by LoadDefaultsCache, lookups never load anything
+	const int32* GroupIndex = GroupIndexByName.Find(GroupName);
+	return GroupIndex ? *GroupIndex : INDEX_NONE;
+}
+
+const FRockAttributeSetInitter::FAttributeSetDefaultsTable* FRockAttributeSetInitter::FindExactDefaultsTable(const FAttributeSetDefaultsGroup& Group, const UClass* SetClass) const
+{
+	const int32* SetIndex = SetIndexByClass.Find(SetClass);
+	if (!SetIndex)
+	{
+		return nullptr;
+	}
+
+	const int32 TableIndex = Group.TableIndexBySet[*SetIndex];
+	return TableIndex != INDEX_NONE ? &Tables[TableIndex] : nullptr;
+}
+
+const FRockAttributeSetInitter::FAttributeSetDefaultsTable* FRockAttributeSetInitter::FindDefaultsTable(const FAttributeSetDefaultsGroup& Group, const UClass* SetClass) const
+{
+	if (const int32* ResolvedTableIndex = Group.ResolvedTableByClass.Find(SetClass))
+	{
+		return *ResolvedTableIndex != INDEX_NONE ? &Tables[*ResolvedTableIndex] : nullptr;
+	}
+
+	// Iterate to find the parent classes, as this could be a derived set
+	const FAttributeSetDefaultsTable* Table = nullptr;
+	for (const UClass* Class = SetClass; Class && !Table; Class = Class->GetSuperClass())
+	{
+		Table = FindExactDefaultsTable(Group, Class);
+	}
+
+	if (Table)
+	{
+		ABILITY_LOG(Verbose, TEXT("Resolved defaults of %s to Parent Class %s in group %s"), *SetClass->GetName(), *Table->SetClass->GetName(), *Group.GroupName.ToString());
+	}
+
+	// Cache misses as well, so sets without defaults don't walk their hierarchy on every spawn either
+	Group.ResolvedTableByClass.Add(SetClass, Table ? UE_PTRDIFF_TO_INT32(Table - Tables.GetData()) : INDEX_NONE);
+	return Table;
+}
+
+void FRockAttributeSetInitter::InitAttributeSetDefaults(
+	UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, int32 Level, bool bInitialInit) const
+{
+	// Integer levels always land exactly on a sample
+	InitAttributeSetDefaultsInterpolated(AbilitySystemComponent, GroupName, static_cast<float>(Level), bInitialInit);
+}
+
+void FRockAttributeSetInitter::InitAttributeSetDefaultsInterpolated(
+	UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, float Level, bool bInitialInit) const
+{
+	check(AbilitySystemComponent != nullptr);
+
+	const int32 GroupIndex = FindGroupIndexWithFallback(GroupName);
+	if (GroupIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	InitAttributeSetDefaultsForGroup(AbilitySystemComponent, GroupIndex, Level, bInitialInit);
+}
+
+void FRockAttributeSetInitter::InitAttributeSetDefaultsForGroup(
+	UAbilitySystemComponent* AbilitySystemComponent, int32 GroupIndex, float Level, bool bInitialInit) const
+{
+	check(AbilitySystemComponent != nullptr);
+	if (!ensure(Groups.IsValidIndex(GroupIndex)))
+	{
+		return;
+	}
+
+	const FAttributeSetDefaultsGroup& Group = Groups[GroupIndex];
+	int32 SampleIndex = 0;
+	float Alpha = 0.f;
+	if (!FindSamplePosition(Group, Level, SampleIndex, Alpha))
+	{
+		// We could eventually extrapolate values outside the max defined levels
+		ABILITY_LOG(Error, TEXT("Init Attribute defaults for Level %.2f are not defined! Skipping"), Level);
+		return;
+	}
+
+	// Gather every default first, so the writes below run as a single batch
+	FPendingAttributeBaseValues BaseValues;
+
+	// Iterate over all the spawned attribute sets of the provided ASC
+	for (UAttributeSet* Set : AbilitySystemComponent->GetSpawnedAttributes())
+	{
+		if (!Set)
+		{
+			continue;
+		}
+
+		// Check our preloaded data to see if we have any curves for the given attribute set...
+		const FAttributeSetDefaultsTable* Table = FindDefaultsTable(Group, Set->GetClass());
+		if (!Table || SampleIndex >= Table->NumSamples)
+		{
+			continue;
+		}
+
+		ABILITY_LOG(Verbose, TEXT("Initializing Set %s"), *Set->GetName());
+		GatherAttributeBaseValues(Set, *Table, SampleIndex, Alpha, bInitialInit, BaseValues);
+	}
+
+	WriteAttributeBaseValues(AbilitySystemComponent, BaseValues);
+}
+
+void FRockAttributeSetInitter::ApplyLevelTransition(UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, int32 FromLevel, int32 ToLevel) const
+{
+	const int32 GroupIndex = FindGroupIndexWithFallback(GroupName);
+	if (GroupIndex != INDEX_NONE)
+	{
+		ApplyLevelTransitionForGroup(AbilitySystemComponent, GroupIndex, FromLevel, ToLevel);
+	}
+}
+
+void FRockAttributeSetInitter::ApplyLevelTransitionForGroup(UAbilitySystemComponent* AbilitySystemComponent, int32 GroupIndex, int32 FromLevel, int32 ToLevel) const
+{
+	check(AbilitySystemComponent != nullptr);
+	if (!ensure(Groups.IsValidIndex(GroupIndex)) || FromLevel == ToLevel)
+	{
+		return;
+	}
+
+	const FAttributeSetDefaultsGroup& Group = Groups[GroupIndex];
+	int32 FromSample = 0;
+	int32 ToSample = 0;
+	float Alpha = 0.f;
+	if (!FindSamplePosition(Group, ToLevel, ToSample, Alpha))
+	{
+		ABILITY_LOG(Error, TEXT("Init Attribute defaults for Level %d are not defined! Skipping"), ToLevel);
+		return;
+	}
+
+	if (!FindSamplePosition(Group, FromLevel, FromSample, Alpha))
+	{
+		// Nothing to diff against, write everything
+		InitAttributeSetDefaultsForGroup(AbilitySystemComponent, GroupIndex, ToLevel, false);
+		return;
+	}
+
+	const int32 LowSample = FMath::Min(FromSample, ToSample);
+	const int32 HighSample = FMath::Max(FromSample, ToSample);
+
+	FPendingAttributeBaseValues BaseValues;
+	for (UAttributeSet* Set : AbilitySystemComponent->GetSpawnedAttributes())
+	{
+		const FAttributeSetDefaultsTable* Table = Set ? FindDefaultsTable(Group, Set->GetClass()) : nullptr;
+		if (!Table || ToSample >= Table->NumSamples)
+		{
+			continue;
+		}
+
+		if (FromSample >= Table->NumSamples)
+		{
+			// The set got no defaults at the previous level, so there's nothing to diff against
+			GatherAttributeBaseValues(Set, *Table, ToSample, 0.f, false, BaseValues);
+			continue;
+		}
+
+		// Any attribute that changed in one of the steps between the two levels may differ, in either direction
+		TBitArray<TInlineAllocator<4>> ChangedInTransition(false, Table->Attributes.Num());
+		const int32 FirstChange = Table->ChangedAttributeOffsets[LowSample + 1];
+		const int32 EndChange = Table->ChangedAttributeOffsets[HighSample + 1];
+		for (int32 ChangeIndex = FirstChange; ChangeIndex < EndChange; ++ChangeIndex)
+		{
+			const int32 AttributeIndex = Table->ChangedAttributes[ChangeIndex];
+			if (ChangedInTransition[AttributeIndex])
+			{
+				continue;
+			}
+			ChangedInTransition[AttributeIndex] = true;
+
+			FProperty* Property = Table->Attributes[AttributeIndex];
+			if (Table->HasValue(AttributeIndex, ToSample) && Set->ShouldInitProperty(false, Property))
+			{
+				BaseValues.Add({ Set, Table, AttributeIndex, Table->GetSampleValues(ToSample)[AttributeIndex] });
+			}
+		}
+	}
+
+	WriteAttributeBaseValues(AbilitySystemComponent, BaseValues);
+}
+
+void FRockAttributeSetInitter::InitAttributeSetDefaultsBatch(TConstArrayView<FRockAttributeDefaultsInitRequest> Requests, bool bInitialInit) const
+{
+	/**
+	 *	Runs serially on the game thread. Gathering a request is a table lookup and a lerp per attribute,
+	 *	far less than the cost of dispatching it to workers, and ShouldInitProperty is virtual game code.
+	 *	The batch saves the repeated group resolution and reuses one gather buffer for every request.
+	 */
+	FPendingAttributeBaseValues BaseValues;
+	for (const FRockAttributeDefaultsInitRequest& Request : Requests)
+	{
+		if (!Request.AbilitySystemComponent || !ensure(Groups.IsValidIndex(Request.GroupIndex)))
+		{
+			continue;
+		}
+
+		const FAttributeSetDefaultsGroup& Group = Groups[Request.GroupIndex];
+		int32 SampleIndex = 0;
+		float Alpha = 0.f;
+		if (!FindSamplePosition(Group, Request.Level, SampleIndex, Alpha))
+		{
+			ABILITY_LOG(Error, TEXT("Init Attribute defaults for Level %.2f are not defined! Skipping"), Request.Level);
+			continue;
+		}
+
+		BaseValues.Reset();
+		for (UAttributeSet* Set : Request.AbilitySystemComponent->GetSpawnedAttributes())
+		{
+			const FAttributeSetDefaultsTable* Table = Set ? FindDefaultsTable(Group, Set->GetClass()) : nullptr;
+			if (Table && SampleIndex < Table->NumSamples)
+			{
+				GatherAttributeBaseValues(Set, *Table, SampleIndex, Alpha, bInitialInit, BaseValues);
+			}
+		}
+
+		if (!BaseValues.IsEmpty())
+		{
+			WriteAttributeBaseValues(Request.AbilitySystemComponent, BaseValues);
+		}
+	}
+}
+
+void FRockAttributeSetInitter::GatherAttributeBaseValues(UAttributeSet* Set, const FAttributeSetDefaultsTable& Table, int32 SampleIndex, float Alpha, bool bInitialInit, FPendingAttributeBaseValues& OutBaseValues)
+{
+	for (int32 AttributeIndex = 0; AttributeIndex < Table.Attributes.Num(); ++AttributeIndex)
+	{
+		FProperty* Property = Table.Attributes[AttributeIndex];
+		check(Property);
+
+		if (Table.HasValue(AttributeIndex, SampleIndex) && Set->ShouldInitProperty(bInitialInit, Property))
+		{
+			OutBaseValues.Add({ Set, &Table, AttributeIndex, Table.GetValue(AttributeIndex, SampleIndex, Alpha) });
+		}
+	}
+}
+
+void FRockAttributeSetInitter::ApplyAttributeDefault(
+	UAbilitySystemComponent* AbilitySystemComponent, FGameplayAttribute& InAttribute, FName GroupName, int32 Level) const
+{
+	// This is same as AttributeSetInitterDiscreteLevels 
+	
+	//SCOPE_CYCLE_COUNTER(STAT_InitAttributeSetDefaults);
+	const int32 GroupIndex = FindGroupIndexWithFallback(GroupName);
+	if (GroupIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	ApplyAttributeDefaultForGroup(AbilitySystemComponent, InAttribute, GroupIndex, Level);
+}
+
+void FRockAttributeSetInitter::ApplyAttributeDefaultForGroup(
+	UAbilitySystemComponent* AbilitySystemComponent, const FGameplayAttribute& InAttribute, int32 GroupIndex, int32 Level) const
+{
+	if (!ensure(Groups.IsValidIndex(GroupIndex)))
+	{
+		return;
+	}
+
+	const FAttributeSetDefaultsGroup& Group = Groups[GroupIndex];
+	int32 SampleIndex = 0;
+	float Alpha = 0.f;
+	if (!FindSamplePosition(Group, Level, SampleIndex, Alpha))
+	{
+		// We could eventually extrapolate values outside the max defined levels
+		ABILITY_LOG(Error, TEXT("Attribute defaults for Level %d are not defined! Skipping"), Level);
+		return;
+	}
+
+	FPendingAttributeBaseValues BaseValues;
+	for (UAttributeSet* Set : AbilitySystemComponent->GetSpawnedAttributes())
+	{
+		if (!Set)
+		{
+			continue;
+		}
+
+		const FAttributeSetDefaultsTable* Table = FindDefaultsTable(Group, Set->GetClass());
+		if (!Table || SampleIndex >= Table->NumSamples)
+		{
+			continue;
+		}
+
+		const int32 AttributeIndex = Table->FindAttributeIndex(InAttribute.GetUProperty());
+		if (AttributeIndex != INDEX_NONE && Table->HasValue(AttributeIndex, SampleIndex))
+		{
+			ABILITY_LOG(Verbose, TEXT("Initializing Set %s"), *Set->GetName());
+
+			BaseValues.Add({ Set, Table, AttributeIndex, Table->GetSampleValues(SampleIndex)[AttributeIndex] });
+		}
+	}
+
+	WriteAttributeBaseValues(AbilitySystemComponent, BaseValues);
+}
+
+void FRockAttributeSetInitter::WriteAttributeBaseValues(UAbilitySystemComponent* AbilitySystemComponent, TConstArrayView<FPendingAttributeBaseValue> BaseValues) const
+{
+	if (BaseValues.IsEmpty())
+	{
+		return;
+	}
+
+	const URockAbilitySystemComponent* RockAbilitySystemComponent = Cast<URockAbilitySystemComponent>(AbilitySystemComponent);
+	const bool bCanWriteDirectly = bWriteAttributesDirectly && RockAbilitySystemComponent && RockAbilitySystemComponent->CanInitAttributesDirectly()
+		&& !Algo::AnyOf(BaseValues, [RockAbilitySystemComponent](const FPendingAttributeBaseValue& BaseValue)
+		{
+			return RockAbilitySystemComponent->HasAttributeAggregator(BaseValue.Table->GameplayAttributes[BaseValue.AttributeIndex]);
+		});
+	if (bCanWriteDirectly)
+	{
+		WriteAttributeValuesDirectly(AbilitySystemComponent, BaseValues);
+	}
+	else
+	{
+		// Attributes backed by an aggregator only store their new base value here. The aggregators are re-evaluated,
+		// and their change delegates broadcast, once when the batch closes instead of after every single write.
+		FScopedAggregatorOnDirtyBatch AggregatorBatch;
+		for (const FPendingAttributeBaseValue& BaseValue : BaseValues)
+		{
+			AbilitySystemComponent->SetNumericAttributeBase(BaseValue.Table->GameplayAttributes[BaseValue.AttributeIndex], BaseValue.Value);
+		}
+	}
+
+	AbilitySystemComponent->ForceReplication();
+}
+
+void FRockAttributeSetInitter::WriteAttributeValuesDirectly(UAbilitySystemComponent* AbilitySystemComponent, TConstArrayView<FPendingAttributeBaseValue> BaseValues)
+{
+	struct FAttributeValueChange
+	{
+		const FGameplayAttribute*	Attribute;
+		float						OldValue;
+		float						NewValue;
+	};
+
+	TArray<FAttributeValueChange, TInlineAllocator<64>> ValueChanges;
+	for (const FPendingAttributeBaseValue& BaseValue : BaseValues)
+	{
+		const FAttributeSetDefaultsTable& Table = *BaseValue.Table;
+		uint8* ValuePtr = reinterpret_cast<uint8*>(BaseValue.Set) + Table.AttributeOffsets[BaseValue.AttributeIndex];
+
+		float OldValue = 0.f;
+		if (const FNumericProperty* NumericProperty = Table.NumericProperties[BaseValue.AttributeIndex])
+		{
+			OldValue = NumericProperty->GetFloatingPointPropertyValue(ValuePtr);
+			NumericProperty->SetFloatingPointPropertyValue(ValuePtr, BaseValue.Value);
+		}
+		else
+		{
+			// Without an aggregator the current value is simply the base value
+			FGameplayAttributeData* AttributeData = reinterpret_cast<FGameplayAttributeData*>(ValuePtr);
+			OldValue = AttributeData->GetCurrentValue();
+			AttributeData->SetBaseValue(BaseValue.Value);
+			AttributeData->SetCurrentValue(BaseValue.Value);
+		}
+
+		if (OldValue != BaseValue.Value)
+		{
+			ValueChanges.Add({ &Table.GameplayAttributes[BaseValue.AttributeIndex], OldValue, BaseValue.Value });
+		}
+	}
+
+	// Listeners only see the new values once every attribute is written
+	for (const FAttributeValueChange& ValueChange : ValueChanges)
+	{
+		FOnAttributeChangeData ChangeData;
+		ChangeData.Attribute = *ValueChange.Attribute;
+		ChangeData.OldValue = ValueChange.OldValue;
+		ChangeData.NewValue = ValueChange.NewValue;
+		AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(*ValueChange.Attribute).Broadcast(ChangeData);
+	}
+}
+
+TArray<float> FRockAttributeSetInitter::GetAttributeSetValues(UClass* AttributeSetClass, FProperty* AttributeProperty, FName GroupName) const
+{
+	const int32 GroupIndex = FindResolvedGroupIndex(GroupName);
+	if (GroupIndex == INDEX_NONE)
+	{
+		ABILITY_LOG(Error, TEXT("FAttributeSetInitterDiscreteLevels::InitAttributeSetDefaults Default DefaultAttributeSet not found! Skipping Initialization"));
+		return TArray<float>();
+	}
+
+	return GetAttributeSetValuesForGroup(AttributeSetClass, AttributeProperty, GroupIndex);
+}
+
+TArray<float> FRockAttributeSetInitter::GetAttributeSetValuesForGroup(UClass* AttributeSetClass, FProperty* AttributeProperty, int32 GroupIndex) const
+{
+	return TArray<float>(GetAttributeSetValuesViewForGroup(AttributeSetClass, AttributeProperty, GroupIndex));
+}
+
+TConstArrayView<float> FRockAttributeSetInitter::GetAttributeSetValuesView(const UClass* AttributeSetClass, const FProperty* AttributeProperty, FName GroupName) const
+{
+	const int32 GroupIndex = FindResolvedGroupIndex(GroupName);
+	return GroupIndex != INDEX_NONE ? GetAttributeSetValuesViewForGroup(AttributeSetClass, AttributeProperty, GroupIndex) : TConstArrayView<float>();
+}
+
+TConstArrayView<float> FRockAttributeSetInitter::GetAttributeSetValuesViewForGroup(const UClass* AttributeSetClass, const FProperty* AttributeProperty, int32 GroupIndex) const
+{
+	if (!ensure(Groups.IsValidIndex(GroupIndex)))
+	{
+		return TConstArrayView<float>();
+	}
+
+	const FAttributeSetDefaultsTable* Table = FindExactDefaultsTable(Groups[GroupIndex], AttributeSetClass);
+	return Table ? Table->GetLevelColumn(Table->FindAttributeIndex(AttributeProperty)) : TConstArrayView<float>();
+}
+
+void FRockAttributeSetInitter::FAttributeSetDefaultsTable::BuildLookups(int32 InSamplesPerLevel)
+{
+	AttributeIndexByProperty.Reset();
+	AttributeIndexByProperty.Reserve(Attributes.Num());
+	for (int32 AttributeIndex = 0; AttributeIndex < Attributes.Num(); ++AttributeIndex)
+	{
+		AttributeIndexByProperty.Add(Attributes[AttributeIndex], AttributeIndex);
+	}
+
+	// One value per whole level, skipping the interpolation samples in between
+	LevelColumnOffsets.SetNumUninitialized(Attributes.Num() + 1);
+	LevelColumnOffsets[0] = 0;
+	for (int32 AttributeIndex = 0; AttributeIndex < Attributes.Num(); ++AttributeIndex)
+	{
+		LevelColumnOffsets[AttributeIndex + 1] = LevelColumnOffsets[AttributeIndex] + FMath::DivideAndRoundUp(AttributeNumSamples[AttributeIndex], InSamplesPerLevel);
+	}
+
+	LevelColumns.SetNumUninitialized(LevelColumnOffsets.Last());
+	for (int32 AttributeIndex = 0; AttributeIndex < Attributes.Num(); ++AttributeIndex)
+	{
+		float* LevelColumn = LevelColumns.GetData() + LevelColumnOffsets[AttributeIndex];
+		for (int32 SampleIndex = 0; SampleIndex < AttributeNumSamples[AttributeIndex]; SampleIndex += InSamplesPerLevel)
+		{
+			*LevelColumn++ = GetSampleValues(SampleIndex)[AttributeIndex];
+		}
+	}
+
+	// Everything a write needs, so initialization never has to look at the properties again
+	GameplayAttributes.Reset(Attributes.Num());
+	AttributeOffsets.Reset(Attributes.Num());
+	NumericProperties.Reset(Attributes.Num());
+	for (FProperty* Property : Attributes)
+	{
+		GameplayAttributes.Emplace(Property);
+		AttributeOffsets.Add(Property->GetOffset_ForInternal());
+		// FGameplayAttributeData properties are written as a struct, only plain numeric properties go through the property
+		NumericProperties.Add(CastField<FNumericProperty>(Property));
+	}
+
+	// Attributes that gain a value or change it from one sample to the next
+	ChangedAttributeOffsets.SetNumUninitialized(NumSamples + 1);
+	ChangedAttributeOffsets[0] = 0;
+	ChangedAttributes.Reset();
+	for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+	{
+		if (SampleIndex > 0)
+		{
+			for (int32 AttributeIndex = 0; AttributeIndex < Attributes.Num(); ++AttributeIndex)
+			{
+				if (HasValue(AttributeIndex, SampleIndex) &&
+					(!HasValue(AttributeIndex, SampleIndex - 1) || GetSampleValues(SampleIndex)[AttributeIndex] != GetSampleValues(SampleIndex - 1)[AttributeIndex]))
+				{
+					ChangedAttributes.Add(AttributeIndex);
+				}
+			}
+		}
+		ChangedAttributeOffsets[SampleIndex + 1] = ChangedAttributes.Num();
+	}
+}
+
+bool FRockAttributeSetInitter::GetAttributeSetDefaults(FName GroupName, const UClass* SetClass, float Level, TArray<FRockAttributeDefaultValue>& OutDefaults) const
+{
+	OutDefaults.Reset();
+
+	const int32 GroupIndex = FindResolvedGroupIndex(GroupName);
+	if (GroupIndex == INDEX_NONE || !SetClass)
+	{
+		return false;
+	}
+
+	const FAttributeSetDefaultsGroup& Group = Groups[GroupIndex];
+	int32 SampleIndex = 0;
+	float Alpha = 0.f;
+	if (!FindSamplePosition(Group, Level, SampleIndex, Alpha))
+	{
+		return false;
+	}
+
+	const FAttributeSetDefaultsTable* Table = FindDefaultsTable(Group, SetClass);
+	if (!Table)
+	{
+		return false;
+	}
+
+	for (int32 AttributeIndex = 0; AttributeIndex < Table->Attributes.Num(); ++AttributeIndex)
+	{
+		if (Table->HasValue(AttributeIndex, SampleIndex))
+		{
+			OutDefaults.Add({ Table->Attributes[AttributeIndex], Table->GetValue(AttributeIndex, SampleIndex, Alpha) });
+		}
+	}
+	return true;
+}
+
+bool FRockAttributeSetInitter::SaveDefaultsCache(const FString& Filename, uint64 SourceStamp) const
+{
+	if (DefaultsCache)
+	{
+		// Already running from a cache built from the same sources
+		return true;
+	}
+
+	TArray<FString> SetClassPaths;
+	SetClassPaths.Reserve(SetClasses.Num());
+	for (const TSubclassOf<UAttributeSet>& SetClass : SetClasses)
+	{
+		SetClassPaths.Add(SetClass->GetPathName());
+	}
+
+	int64 NumValues = 0;
+	for (const FAttributeSetDefaultsTable& Table : Tables)
+	{
+		NumValues += Table.Values.Num();
+	}
+
+	TArray<float> Values;
+	Values.Reserve(NumValues);
+
+	TArray<FRockAttributeDefaultsCacheGroup> CacheGroups;
+	CacheGroups.Reserve(Groups.Num());
+	for (const FAttributeSetDefaultsGroup& Group : Groups)
+	{
+		FRockAttributeDefaultsCacheGroup& CacheGroup = CacheGroups.AddDefaulted_GetRef();
+		CacheGroup.GroupName = Group.GroupName;
+		CacheGroup.NumSamples = Group.NumSamples;
+
+		for (int32 SetIndex = 0; SetIndex < Group.TableIndexBySet.Num(); ++SetIndex)
+		{
+			const int32 TableIndex = Group.TableIndexBySet[SetIndex];
+			if (TableIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			const FAttributeSetDefaultsTable& Table = Tables[TableIndex];
+			FRockAttributeDefaultsCacheTable& CacheTable = CacheGroup.Tables.AddDefaulted_GetRef();
+			CacheTable.SetIndex = SetIndex;
+			CacheTable.NumSamples = Table.NumSamples;
+			CacheTable.NumRows = Table.RowBySample.Num() > 0 ? FMath::Max(Table.RowBySample) + 1 : 0;
+			CacheTable.RowBySample = Table.RowBySample;
+			CacheTable.AttributeNumSamples = Table.AttributeNumSamples;
+			CacheTable.ValueOffset = Values.Num();
+			CacheTable.AttributeNames.Reserve(Table.Attributes.Num());
+			for (const FProperty* Property : Table.Attributes)
+			{
+				CacheTable.AttributeNames.Add(Property->GetFName());
+			}
+			Values.Append(Table.Values);
+		}
+	}
+
+	return FRockAttributeDefaultsCache::Save(Filename, SourceStamp, SamplesPerLevel, SetClassPaths, CacheGroups, Values);
+}
+
+bool FRockAttributeSetInitter::LoadDefaultsCache(const FString& Filename, uint64 SourceStamp)
+{
+	TUniquePtr<FRockAttributeDefaultsCache> Cache = MakeUnique<FRockAttributeDefaultsCache>();
+	if (!Cache->Load(Filename, SourceStamp, SamplesPerLevel))
+	{
+		return false;
+	}
+
+	GroupIndexByName.Reset();
+	Groups.Reset();
+	SetIndexByClass.Reset();
+	SetClasses.Reset();
+	Tables.Reset();
+
+	// Classes are loaded when the first group using them is resolved
+	SetClasses.SetNum(Cache->SetClassPaths.Num());
+
+	// The resolved tables point into the mapped values, so the cache is installed first
+	DefaultsCache = MoveTemp(Cache);
+	AdvanceGeneration();
+
+	Groups.Reserve(DefaultsCache->Groups.Num());
+	for (const FRockAttributeDefaultsCacheGroup& CacheGroup : DefaultsCache->Groups)
+	{
+		const int32 GroupIndex = Groups.AddDefaulted();
+		FAttributeSetDefaultsGroup& Group = Groups[GroupIndex];
+		Group.GroupName = CacheGroup.GroupName;
+		Group.NumSamples = CacheGroup.NumSamples;
+		Group.TableIndexBySet.Init(INDEX_NONE, SetClasses.Num());
+		GroupIndexByName.Add(Group.GroupName, GroupIndex);
+
+		if (!ResolveCachedGroup(GroupIndex, CacheGroup))
+		{
+			ABILITY_LOG(Log, TEXT("Attribute defaults cache %s is stale, ignoring it"), *Filename);
+
+			// Drop every table before the mapping they point into
+			GroupIndexByName.Reset();
+			Groups.Reset();
+			SetIndexByClass.Reset();
+			SetClasses.Reset();
+			Tables.Reset();
+			DefaultsCache.Reset();
+			UpdateMemoryStats();
+			return false;
+		}
+	}
+
+	UpdateMemoryStats();
+
+	ABILITY_LOG(Log, TEXT("Loaded attribute defaults cache %s (%d groups)"), *Filename, Groups.Num());
+	return true;
+}
+
+bool FRockAttributeSetInitter::ResolveCachedGroup(int32 GroupIndex, const FRockAttributeDefaultsCacheGroup& CacheGroup)
+{
+	FAttributeSetDefaultsGroup& Group = Groups[GroupIndex];
+	check(DefaultsCache);
+
+	for (const FRockAttributeDefaultsCacheTable& CacheTable : CacheGroup.Tables)
+	{
+		if (!SetClasses.IsValidIndex(CacheTable.SetIndex))
+		{
+			return false;
+		}
+
+		TSubclassOf<UAttributeSet>& SetClass = SetClasses[CacheTable.SetIndex];
+		if (!SetClass)
+		{
+			SetClass = FSoftClassPath(DefaultsCache->SetClassPaths[CacheTable.SetIndex]).TryLoadClass<UAttributeSet>();
+			if (!SetClass)
+			{
+				ABILITY_LOG(Log, TEXT("Attribute defaults cache references missing class %s"), *DefaultsCache->SetClassPaths[CacheTable.SetIndex]);
+				return false;
+			}
+			SetIndexByClass.Add(*SetClass, CacheTable.SetIndex);
+		}
+
+		FAttributeSetDefaultsTable Table;
+		Table.SetClass = SetClass;
+		Table.NumSamples = CacheTable.NumSamples;
+		Table.AttributeNumSamples = CacheTable.AttributeNumSamples;
+		Table.Attributes.Reserve(CacheTable.AttributeNames.Num());
+		for (const FName& AttributeName : CacheTable.AttributeNames)
+		{
+			FProperty* Property = FindFProperty<FProperty>(*SetClass, AttributeName);
+			if (!IsSupportedProperty(Property))
+			{
+				ABILITY_LOG(Log, TEXT("Attribute defaults cache references missing attribute %s.%s"), *SetClass->GetName(), *AttributeName.ToString());
+				return false;
+			}
+			Table.Attributes.Add(Property);
+		}
+
+		Table.RowBySample = CacheTable.RowBySample;
+		// Row indices were range checked against NumRows when the cache was loaded
+		const int32 NumRows = CacheTable.NumRows;
+		Table.Values = DefaultsCache->GetValues(CacheTable.ValueOffset, static_cast<int64>(NumRows) * Table.Attributes.Num());
+		if (Table.Values.Num() != NumRows * Table.Attributes.Num() || Table.RowBySample.Num() != Table.NumSamples || Table.AttributeNumSamples.Num() != Table.Attributes.Num())
+		{
+			return false;
+		}
+
+		Table.BuildLookups(SamplesPerLevel);
+		Group.TableIndexBySet[CacheTable.SetIndex] = Tables.Add(MoveTemp(Table));
+	}
+
+	return true;
 }
 
 bool FRockAttributeSetInitter::IsSupportedProperty(FProperty* Property) const
@@ -7,6 +7,8 @@
 #include "AbilitySystemInterface.h"
 #include "AbilitySystem/RockGameplayTags.h"
 #include "AbilitySystem/Assets/RockAbilityTagRelationshipMapping.h"
+#include "AbilitySystem/Attributes/RockAttributeSet.h"
+#include "AbilitySystem/Global/RockAbilitySystemGlobals.h"
 #include "AbilitySystem/Global/RockGlobalAbilitySystem.h"
 #include "Animation/RockAnimInstance.h"
 #include "Logging/RockLogging.h"
@@ -30,6 +32,10 @@ void URockAbilitySystemComponent::EndPlay(const EEndPlayReason::Type EndPlayReas
 		GlobalAbilitySystem->UnregisterASC(this);
 	}
 
+	URockAbilitySystemGlobals::Get().UntrackAttributeDefaultsTarget(this);
+
+	PendingReplicatedAttributeChanges.Reset();
+
 	Super::EndPlay(EndPlayReason);
 }
 
@@ -453,19 +459,63 @@ void URockAbilitySystemComponent::CancelActivationGroupAbilities(
 void URockAbilitySystemComponent::DeferredSetBaseAttributeValueFromReplication(
 	const FGameplayAttribute& attribute, const FGameplayAttributeData& newValue)
 {
-	const float OldValue = ActiveGameplayEffects.GetAttributeBaseValue(attribute);
-	ActiveGameplayEffects.SetAttributeBaseValue(attribute, newValue.GetBaseValue());
-	SetBaseAttributeValueFromReplication(attribute, newValue.GetBaseValue(), OldValue);
-	// TODO: You can process deferred delegates here
+	QueueReplicatedBaseAttributeValue(attribute, newValue.GetBaseValue());
 }
 
 void URockAbilitySystemComponent::DeferredSetBaseAttributeValueFromReplication(
 	const FGameplayAttribute& attribute, float newValue)
 {
-	const float OldValue = ActiveGameplayEffects.GetAttributeBaseValue(attribute);
-	ActiveGameplayEffects.SetAttributeBaseValue(attribute, newValue);
-	SetBaseAttributeValueFromReplication(attribute, newValue, OldValue);
-	// TODO: You can process deferred delegates here
+	QueueReplicatedBaseAttributeValue(attribute, newValue);
+}
+
+void URockAbilitySystemComponent::FlushReplicatedAttributeChanges()
+{
+	if (PendingReplicatedAttributeChanges.IsEmpty())
+	{
+		return;
+	}
+
+	// Listeners may trigger more replication work, apply a stable copy
+	const TArray<FPendingReplicatedAttributeChange> Changes = MoveTemp(PendingReplicatedAttributeChanges);
+	PendingReplicatedAttributeChanges.Reset();
+
+	// Every value is applied before any aggregator broadcasts, so listeners see the whole update at once
+	FScopedAggregatorOnDirtyBatch AggregatorBatch;
+	for (const FPendingReplicatedAttributeChange& Change : Changes)
+	{
+		ApplyReplicatedBaseAttributeValue(Change.Attribute, Change.NewBaseValue, Change.OldBaseValue);
+	}
+}
+
+void URockAbilitySystemComponent::QueueReplicatedBaseAttributeValue(const FGameplayAttribute& Attribute, float NewBaseValue)
+{
+	const float OldValue = ActiveGameplayEffects.GetAttributeBaseValue(Attribute);
+
+	// Only sets that flush from their PostRepNotifies can be deferred
+	const UClass* SetClass = Attribute.GetAttributeSetClass();
+	if (!bDeferReplicatedAttributeChanges || !SetClass || !SetClass->IsChildOf<URockAttributeSet>())
+	{
+		ApplyReplicatedBaseAttributeValue(Attribute, NewBaseValue, OldValue);
+		return;
+	}
+
+	// Keep the value from before the first update and the latest value, the attribute only changes once
+	if (FPendingReplicatedAttributeChange* Pending = PendingReplicatedAttributeChanges.FindByPredicate([&Attribute](const FPendingReplicatedAttributeChange& Change)
+	{
+		return Change.Attribute == Attribute;
+	}))
+	{
+		Pending->NewBaseValue = NewBaseValue;
+		return;
+	}
+
+	PendingReplicatedAttributeChanges.Add({ Attribute, OldValue, NewBaseValue });
+}
+
+void URockAbilitySystemComponent::ApplyReplicatedBaseAttributeValue(const FGameplayAttribute& Attribute, float NewBaseValue, float OldBaseValue)
+{
+	ActiveGameplayEffects.SetAttributeBaseValue(Attribute, NewBaseValue);
+	SetBaseAttributeValueFromReplication(Attribute, NewBaseValue, OldBaseValue);
 }
 
 void URockAbilitySystemComponent::GetAbilityTargetData(
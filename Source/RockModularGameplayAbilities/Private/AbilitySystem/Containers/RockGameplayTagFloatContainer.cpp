@@ -2,14 +2,145 @@
 
 #include "AbilitySystem/Containers/RockGameplayTagFloatContainer.h"
 
+#include "AbilitySystem/Global/RockAbilitySystemGlobals.h"
+
+#include <cmath>
+
+//////////////////////////////////////////////////////////////////////
+// FRockTagFloatQuantization
+
+uint32 FRockTagFloatQuantization::Quantize(float Value) const
+{
+	const uint32 MaxQuantized = (1u << NumBits) - 1;
+	const float Alpha = FMath::Clamp((Value - MinValue) / (MaxValue - MinValue), 0.f, 1.f);
+	return static_cast<uint32>(FMath::RoundToInt(Alpha * MaxQuantized));
+}
+
+float FRockTagFloatQuantization::Dequantize(uint32 QuantizedValue) const
+{
+	const uint32 MaxQuantized = (1u << NumBits) - 1;
+	return MinValue + (MaxValue - MinValue) * (static_cast<float>(FMath::Min(QuantizedValue, MaxQuantized)) / MaxQuantized);
+}
+
+//////////////////////////////////////////////////////////////////////
+// FRockGameplayTagFloat
+
 FString FRockGameplayTagFloat::GetDebugString() const
 {
 	return FString::Printf(TEXT("%sx%f"), *Tag.ToString(), FloatValue);
 }
 
+bool FRockGameplayTagFloat::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+	Tag.NetSerialize(Ar, Map, bOutSuccess);
+
+	const FRockTagFloatQuantization& Quantization = GetNetQuantization(Tag);
+	if (!Quantization.IsEnabled())
+	{
+		Ar << FloatValue;
+		return true;
+	}
+
+	uint32 QuantizedValue = Ar.IsSaving() ? Quantization.Quantize(FloatValue) : 0;
+	Ar.SerializeInt(QuantizedValue, 1u << Quantization.NumBits);
+	if (Ar.IsLoading())
+	{
+		FloatValue = DequantizeValue(Quantization, QuantizedValue);
+	}
+	return true;
+}
+
+const FRockTagFloatQuantization& FRockGameplayTagFloat::GetNetQuantization(FGameplayTag Tag)
+{
+	static const FRockTagFloatQuantization FullPrecision;
+	// Projects may use their own globals class, those replicate full floats
+	const URockAbilitySystemGlobals* Globals = Cast<URockAbilitySystemGlobals>(IGameplayAbilitiesModule::Get().GetAbilitySystemGlobals());
+	return Globals ? Globals->GetTagFloatNetQuantization(Tag) : FullPrecision;
+}
+
+//////////////////////////////////////////////////////////////////////
+// FRockGameplayTagIndexMap
+
+void FRockGameplayTagIndexMap::Add(FGameplayTag Tag, int32 Index)
+{
+	if (bHashed)
+	{
+		HashedEntries.Add(Tag, Index);
+		return;
+	}
+
+	const int32 InsertIndex = Algo::LowerBoundBy(SortedEntries, Tag.GetTagName(), &GetEntryName, FNameFastLess());
+	if (SortedEntries.IsValidIndex(InsertIndex) && SortedEntries[InsertIndex].Tag == Tag)
+	{
+		SortedEntries[InsertIndex].Index = Index;
+		return;
+	}
+
+	if (SortedEntries.Num() < InlineCapacity)
+	{
+		SortedEntries.Insert({ Tag, Index }, InsertIndex);
+		return;
+	}
+
+	// Too many tags to keep inline, move everything to the hash map
+	HashedEntries.Reserve(SortedEntries.Num() + 1);
+	for (const FEntry& Entry : SortedEntries)
+	{
+		HashedEntries.Add(Entry.Tag, Entry.Index);
+	}
+	HashedEntries.Add(Tag, Index);
+	SortedEntries.Empty();
+	bHashed = true;
+}
+
+void FRockGameplayTagIndexMap::Remove(FGameplayTag Tag)
+{
+	if (bHashed)
+	{
+		HashedEntries.Remove(Tag);
+		return;
+	}
+
+	const int32 EntryIndex = FindSortedEntry(Tag);
+	if (EntryIndex != INDEX_NONE)
+	{
+		SortedEntries.RemoveAt(EntryIndex, 1, EAllowShrinking::No);
+	}
+}
+
+void FRockGameplayTagIndexMap::Reset()
+{
+	SortedEntries.Reset();
+	HashedEntries.Empty();
+	bHashed = false;
+}
+
+//////////////////////////////////////////////////////////////////////
+// FRockGameplayTagFloatAggregate
+
+float FRockGameplayTagFloatAggregate::GetProduct() const
+{
+	return static_cast<float>(std::ldexp(ProductMantissa, ProductExponent));
+}
+
+bool FRockGameplayTagFloatAggregate::ScaleProduct(double Factor)
+{
+	// Keeps the mantissa in [0.5, 1), so the product itself never leaves double range
+	int Exponent = 0;
+	ProductMantissa = std::frexp(ProductMantissa * Factor, &Exponent);
+	ProductExponent += Exponent;
+	return ProductMantissa > 0.0 && FMath::IsFinite(ProductMantissa);
+}
+
 //////////////////////////////////////////////////////////////////////
 // FGameplayTagStackContainer
 
+bool FRockGameplayTagFloatContainer::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	return FFastArraySerializer::FastArrayDeltaSerialize<FRockGameplayTagFloat, FRockGameplayTagFloatContainer>(Stacks, DeltaParms, *this);
+}
+
 void FRockGameplayTagFloatContainer::AddFloat(FGameplayTag Tag, float FloatValue)
 {
 	if (!Tag.IsValid())
@@ -20,21 +151,19 @@ void FRockGameplayTagFloatContainer::AddFloat(FGameplayTag Tag, float FloatValue
 
 	if (FloatValue > 0)
 	{
-		for (FRockGameplayTagFloat& Stack : Stacks)
+		if (const int32* StackIndex = TagToIndexMap.Find(Tag))
 		{
-			if (Stack.Tag == Tag)
-			{
-				const float NewCount = Stack.FloatValue+ FloatValue;
-				Stack.FloatValue = NewCount;
-				TagToFloatMap[Tag] = NewCount;
-				MarkItemDirty(Stack);
-				return;
-			}
+			FRockGameplayTagFloat& Stack = Stacks[*StackIndex];
+			Stack.FloatValue += FloatValue;
+			UpdateAggregates(Stack, Stack.FloatValue);
+			MarkItemDirty(Stack);
+			return;
 		}
 
+		TagToIndexMap.Add(Tag, Stacks.Num());
 		FRockGameplayTagFloat& NewStack = Stacks.Emplace_GetRef(Tag, FloatValue);
+		UpdateAggregates(NewStack, NewStack.FloatValue);
 		MarkItemDirty(NewStack);
-		TagToFloatMap.Add(Tag, FloatValue);
 	}
 }
 
@@ -48,21 +177,19 @@ void FRockGameplayTagFloatContainer::SetFloat(FGameplayTag Tag, float FloatValue
 	
 	if (FloatValue > 0)
 	{
-		for (FRockGameplayTagFloat& Stack : Stacks)
+		if (const int32* StackIndex = TagToIndexMap.Find(Tag))
 		{
-			if (Stack.Tag == Tag)
-			{
-				const float NewCount = FloatValue;
-				Stack.FloatValue = NewCount;
-				TagToFloatMap[Tag] = NewCount;
-				MarkItemDirty(Stack);
-				return;
-			}
+			FRockGameplayTagFloat& Stack = Stacks[*StackIndex];
+			Stack.FloatValue = FloatValue;
+			UpdateAggregates(Stack, Stack.FloatValue);
+			MarkItemDirty(Stack);
+			return;
 		}
 
+		TagToIndexMap.Add(Tag, Stacks.Num());
 		FRockGameplayTagFloat& NewStack = Stacks.Emplace_GetRef(Tag, FloatValue);
+		UpdateAggregates(NewStack, NewStack.FloatValue);
 		MarkItemDirty(NewStack);
-		TagToFloatMap.Add(Tag, FloatValue);
 	}
 }
 
@@ -77,26 +204,23 @@ void FRockGameplayTagFloatContainer::SubtractFloat(FGameplayTag Tag, float Float
 	//@TODO: Should we error if you try to remove a stack that doesn't exist or has a smaller count?
 	if (FloatValue > 0)
 	{
-		for (auto It = Stacks.CreateIterator(); It; ++It)
+		const int32* StackIndex = TagToIndexMap.Find(Tag);
+		if (!StackIndex)
 		{
-			FRockGameplayTagFloat& Stack = *It;
-			if (Stack.Tag == Tag)
-			{
-				if (Stack.FloatValue <= FloatValue)
-				{
-					It.RemoveCurrent();
-					TagToFloatMap.Remove(Tag);
-					MarkArrayDirty();
-				}
-				else
-				{
-					const float NewCount = Stack.FloatValue - FloatValue;
-					Stack.FloatValue = NewCount;
-					TagToFloatMap[Tag] = NewCount;
-					MarkItemDirty(Stack);
-				}
-				return;
-			}
+			return;
+		}
+
+		FRockGameplayTagFloat& Stack = Stacks[*StackIndex];
+		if (Stack.FloatValue <= FloatValue)
+		{
+			RemoveStackAt(*StackIndex);
+			MarkArrayDirty();
+		}
+		else
+		{
+			Stack.FloatValue -= FloatValue;
+			UpdateAggregates(Stack, Stack.FloatValue);
+			MarkItemDirty(Stack);
 		}
 	}
 }
@@ -109,45 +233,280 @@ void FRockGameplayTagFloatContainer::RemoveTag(FGameplayTag Tag)
 		return;
 	}
 
-	for (auto It = Stacks.CreateIterator(); It; ++It)
+	if (const int32* StackIndex = TagToIndexMap.Find(Tag))
+	{
+		RemoveStackAt(*StackIndex);
+		MarkArrayDirty();
+	}
+}
+
+void FRockGameplayTagFloatContainer::RemoveStackAt(int32 StackIndex)
+{
+	UpdateAggregates(Stacks[StackIndex], 0.f);
+
+	// Items are matched by replication ID, not by index, so the order of Stacks doesn't matter to the fast array
+	TagToIndexMap.Remove(Stacks[StackIndex].Tag);
+	Stacks.RemoveAtSwap(StackIndex, 1, EAllowShrinking::No);
+	if (Stacks.IsValidIndex(StackIndex))
+	{
+		TagToIndexMap[Stacks[StackIndex].Tag] = StackIndex;
+	}
+}
+
+void FRockGameplayTagFloatContainer::RebuildTagToIndexMap()
+{
+	TagToIndexMap.Reset();
+	for (int32 StackIndex = 0; StackIndex < Stacks.Num(); ++StackIndex)
+	{
+		TagToIndexMap.Add(Stacks[StackIndex].Tag, StackIndex);
+	}
+	bTagToIndexMapStale = false;
+}
+
+float FRockGameplayTagFloatContainer::GetAggregateProduct(FGameplayTag ParentTag) const
+{
+	const FRockGameplayTagFloatAggregate* Aggregate = FindAggregate(ParentTag);
+	return Aggregate ? Aggregate->GetProduct() : 1.f;
+}
+
+FRockGameplayTagFloatAggregate* FRockGameplayTagFloatContainer::FindAggregate(FGameplayTag ParentTag) const
+{
+	if (!bAggregatesBuilt)
+	{
+		BuildAggregates();
+	}
+	return ParentAggregates.Find(ParentTag);
+}
+
+void FRockGameplayTagFloatContainer::BuildAggregates() const
+{
+	bAggregatesBuilt = true;
+	ParentAggregates.Reset();
+	for (const FRockGameplayTagFloat& Stack : Stacks)
+	{
+		Stack.AggregatedValue = 0.f;
+		UpdateAggregates(Stack, Stack.FloatValue);
+	}
+}
+
+void FRockGameplayTagFloatContainer::UpdateAggregates(const FRockGameplayTagFloat& Stack, float NewValue) const
+{
+	const float OldValue = Stack.AggregatedValue;
+	if (!bAggregatesBuilt || OldValue == NewValue)
 	{
-		FRockGameplayTagFloat& Stack = *It;
-		if (Stack.Tag == Tag)
+		return;
+	}
+
+	// Stored values are always positive, a value of 0 means the stack isn't part of the aggregates
+	Stack.AggregatedValue = NewValue;
+	const bool bWasAggregated = OldValue > 0.f;
+	const bool bIsAggregated = NewValue > 0.f;
+
+	for (FGameplayTag ParentTag = Stack.Tag; ParentTag.IsValid(); ParentTag = ParentTag.RequestDirectParent())
+	{
+		FRockGameplayTagFloatAggregate& Aggregate = ParentAggregates.FindOrAdd(ParentTag);
+		Aggregate.Count += static_cast<int32>(bIsAggregated) - static_cast<int32>(bWasAggregated);
+		if (Aggregate.Count <= 0)
 		{
-			It.RemoveCurrent();
-			TagToFloatMap.Remove(Tag);
-			MarkArrayDirty();
-			return;
+			ParentAggregates.Remove(ParentTag);
+			continue;
+		}
+
+		Aggregate.Sum += (bIsAggregated ? NewValue : 0.f) - (bWasAggregated ? OldValue : 0.f);
+
+		// The old value is divided back out in double precision, the drift of that stays far below float precision
+		const double ProductFactor = (bIsAggregated ? static_cast<double>(NewValue) : 1.0) / (bWasAggregated ? static_cast<double>(OldValue) : 1.0);
+		if (!Aggregate.ScaleProduct(ProductFactor))
+		{
+			RecomputeAggregateProduct(ParentTag, Aggregate);
+		}
+
+		if (bIsAggregated && NewValue >= Aggregate.Max)
+		{
+			Aggregate.Max = NewValue;
+		}
+		else if (bWasAggregated && OldValue >= Aggregate.Max)
+		{
+			// The largest value went down, only then the other stacks under this tag have to be looked at
+			Aggregate.Max = FindAggregateMax(ParentTag);
+		}
+	}
+}
+
+void FRockGameplayTagFloatContainer::RecomputeAggregateProduct(FGameplayTag ParentTag, FRockGameplayTagFloatAggregate& Aggregate) const
+{
+	Aggregate.ProductMantissa = 1.0;
+	Aggregate.ProductExponent = 0;
+	for (const FRockGameplayTagFloat& Stack : Stacks)
+	{
+		if (Stack.AggregatedValue > 0.f && Stack.Tag.MatchesTag(ParentTag))
+		{
+			Aggregate.ScaleProduct(Stack.AggregatedValue);
 		}
 	}
 }
 
+float FRockGameplayTagFloatContainer::FindAggregateMax(FGameplayTag ParentTag) const
+{
+	float Max = 0.f;
+	for (const FRockGameplayTagFloat& Stack : Stacks)
+	{
+		if (Stack.AggregatedValue > Max && Stack.Tag.MatchesTag(ParentTag))
+		{
+			Max = Stack.AggregatedValue;
+		}
+	}
+	return Max;
+}
+
 void FRockGameplayTagFloatContainer::PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize)
 {
 	for (int32 Index : RemovedIndices)
 	{
-		const FGameplayTag Tag = Stacks[Index].Tag;
-		TagToFloatMap.Remove(Tag);
+		UpdateAggregates(Stacks[Index], 0.f);
+		TagToIndexMap.Remove(Stacks[Index].Tag);
 	}
+
+	// The removed items are swapped out after this, which moves other items around
+	bTagToIndexMapStale = true;
 }
 
 void FRockGameplayTagFloatContainer::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
 {
 	for (int32 Index : AddedIndices)
 	{
-		const FRockGameplayTagFloat& Stack = Stacks[Index];
-		TagToFloatMap.Add(Stack.Tag, Stack.FloatValue);
+		TagToIndexMap.Add(Stacks[Index].Tag, Index);
+		UpdateAggregates(Stacks[Index], Stacks[Index].FloatValue);
 	}
 }
 
 void FRockGameplayTagFloatContainer::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
 {
+	// Values are read straight from Stacks, a changed item keeps its tag and index
 	for (int32 Index : ChangedIndices)
 	{
-		const FRockGameplayTagFloat& Stack = Stacks[Index];
-		// Original: TagToCountMap[Stack.Tag] = Stack.StackCount;
-		// Suggested fix. 
-		TagToFloatMap.Emplace(Stack.Tag, Stack.FloatValue);		
-		
+		UpdateAggregates(Stacks[Index], Stacks[Index].FloatValue);
+	}
+}
+
+void FRockGameplayTagFloatContainer::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	if (bTagToIndexMapStale)
+	{
+		RebuildTagToIndexMap();
 	}
 }
+
+
+//////////////////////////////////////////////////////////////////////
+// FRockGameplayTagFloatBatchEdit
+
+FRockGameplayTagFloatBatchEdit::FTagEdit& FRockGameplayTagFloatBatchEdit::FindOrAddEdit(FGameplayTag Tag)
+{
+	if (FTagEdit* Edit = Edits.FindByPredicate([Tag](const FTagEdit& Pending) { return Pending.Tag == Tag; }))
+	{
+		return *Edit;
+	}
+
+	// Start from the current value, so every change follows the same rules as the matching container function
+	FTagEdit& Edit = Edits.AddDefaulted_GetRef();
+	Edit.Tag = Tag;
+	Edit.Value = Container.GetFloatValue(Tag);
+	return Edit;
+}
+
+void FRockGameplayTagFloatBatchEdit::AddFloat(FGameplayTag Tag, float FloatValue)
+{
+	if (!Tag.IsValid())
+	{
+		FFrame::KismetExecutionMessage(TEXT("An invalid tag was passed to AddStack"), ELogVerbosity::Warning);
+		return;
+	}
+
+	if (FloatValue > 0)
+	{
+		FindOrAddEdit(Tag).Value += FloatValue;
+	}
+}
+
+void FRockGameplayTagFloatBatchEdit::SetFloat(FGameplayTag Tag, float FloatValue)
+{
+	if (!Tag.IsValid())
+	{
+		FFrame::KismetExecutionMessage(TEXT("An invalid tag was passed to SetStack"), ELogVerbosity::Warning);
+		return;
+	}
+
+	if (FloatValue > 0)
+	{
+		FindOrAddEdit(Tag).Value = FloatValue;
+	}
+}
+
+void FRockGameplayTagFloatBatchEdit::SubtractFloat(FGameplayTag Tag, float FloatValue)
+{
+	if (!Tag.IsValid())
+	{
+		FFrame::KismetExecutionMessage(TEXT("An invalid tag was passed to RemoveStack"), ELogVerbosity::Warning);
+		return;
+	}
+
+	if (FloatValue > 0)
+	{
+		// Subtracting from a missing tag does nothing, subtracting all of it or more removes it
+		FTagEdit& Edit = FindOrAddEdit(Tag);
+		Edit.Value = Edit.Value > FloatValue ? Edit.Value - FloatValue : 0.f;
+	}
+}
+
+void FRockGameplayTagFloatBatchEdit::RemoveTag(FGameplayTag Tag)
+{
+	if (!Tag.IsValid())
+	{
+		FFrame::KismetExecutionMessage(TEXT("An invalid tag was passed to RemoveTag"), ELogVerbosity::Warning);
+		return;
+	}
+
+	FindOrAddEdit(Tag).Value = 0.f;
+}
+
+void FRockGameplayTagFloatBatchEdit::Commit()
+{
+	bool bRemovedStacks = false;
+
+	for (const FTagEdit& Edit : Edits)
+	{
+		const int32* StackIndex = Container.TagToIndexMap.Find(Edit.Tag);
+		if (!StackIndex)
+		{
+			if (Edit.Value > 0)
+			{
+				Container.TagToIndexMap.Add(Edit.Tag, Container.Stacks.Num());
+				FRockGameplayTagFloat& NewStack = Container.Stacks.Emplace_GetRef(Edit.Tag, Edit.Value);
+				Container.UpdateAggregates(NewStack, NewStack.FloatValue);
+				Container.MarkItemDirty(NewStack);
+			}
+			continue;
+		}
+
+		FRockGameplayTagFloat& Stack = Container.Stacks[*StackIndex];
+		if (Edit.Value <= 0)
+		{
+			Container.RemoveStackAt(*StackIndex);
+			bRemovedStacks = true;
+		}
+		else if (Edit.Value != Stack.FloatValue)
+		{
+			Stack.FloatValue = Edit.Value;
+			Container.UpdateAggregates(Stack, Edit.Value);
+			Container.MarkItemDirty(Stack);
+		}
+	}
+
+	if (bRemovedStacks)
+	{
+		Container.MarkArrayDirty();
+	}
+
+	Edits.Reset();
+}
@@ -0,0 +1,201 @@
+// Copyright Broken Rock Studios LLC. All Rights Reserved.
+
+#include "AbilitySystem/Containers/RockGameplayTagFloatNetSerializer.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(RockGameplayTagFloatNetSerializer)
+
+#if UE_WITH_IRIS
+
+#include "GameplayTagsManager.h"
+#include "AbilitySystem/Containers/RockGameplayTagFloatContainer.h"
+#include "Iris/ReplicationState/PropertyNetSerializerInfoRegistry.h"
+#include "Iris/Serialization/NetBitStreamReader.h"
+#include "Iris/Serialization/NetBitStreamWriter.h"
+#include "Iris/Serialization/NetSerializerDelegates.h"
+
+namespace UE::Net
+{
+
+struct FRockGameplayTagFloatNetSerializer
+{
+	static constexpr uint32 Version = 0;
+
+	struct FQuantizedType
+	{
+		// Net index of the tag, see UGameplayTagsManager::GetNetIndexFromTag
+		uint32 TagNetIndex;
+		// Value encoded with the quantization of the tag, or the bits of the float if the tag isn't quantized
+		uint32 FloatValueBits;
+	};
+
+	typedef FRockGameplayTagFloat SourceType;
+	typedef FRockGameplayTagFloatNetSerializerConfig ConfigType;
+
+	static const ConfigType DefaultConfig;
+
+	static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+	static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+
+	static void SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args);
+	static void DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args);
+
+	static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+	static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+
+	static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+	static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+
+private:
+	class FNetSerializerRegistryDelegates final : private UE::Net::FNetSerializerRegistryDelegates
+	{
+	public:
+		virtual ~FNetSerializerRegistryDelegates();
+
+	private:
+		virtual void OnPreFreezeNetSerializerRegistry() override;
+	};
+
+	static FRockGameplayTagFloatNetSerializer::FNetSerializerRegistryDelegates NetSerializerRegistryDelegates;
+
+	static uint32 GetTagNetIndexBits()
+	{
+		return static_cast<uint32>(UGameplayTagsManager::Get().GetNetIndexTrueBitNum());
+	}
+
+	static const FRockTagFloatQuantization& GetQuantization(uint32 TagNetIndex)
+	{
+		return FRockGameplayTagFloat::GetNetQuantization(UGameplayTagsManager::Get().GetTagFromNetIndex(static_cast<FGameplayTagNetIndex>(TagNetIndex)));
+	}
+
+	static uint32 GetValueBits(uint32 TagNetIndex)
+	{
+		const FRockTagFloatQuantization& Quantization = GetQuantization(TagNetIndex);
+		return Quantization.IsEnabled() ? static_cast<uint32>(Quantization.NumBits) : 32U;
+	}
+};
+
+UE_NET_IMPLEMENT_SERIALIZER(FRockGameplayTagFloatNetSerializer);
+
+const FRockGameplayTagFloatNetSerializer::ConfigType FRockGameplayTagFloatNetSerializer::DefaultConfig;
+FRockGameplayTagFloatNetSerializer::FNetSerializerRegistryDelegates FRockGameplayTagFloatNetSerializer::NetSerializerRegistryDelegates;
+
+void FRockGameplayTagFloatNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+{
+	const FQuantizedType& Value = *reinterpret_cast<const FQuantizedType*>(Args.Source);
+
+	FNetBitStreamWriter* Writer = Context.GetBitStreamWriter();
+	Writer->WriteBits(Value.TagNetIndex, GetTagNetIndexBits());
+	Writer->WriteBits(Value.FloatValueBits, GetValueBits(Value.TagNetIndex));
+}
+
+void FRockGameplayTagFloatNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+{
+	FQuantizedType& Target = *reinterpret_cast<FQuantizedType*>(Args.Target);
+
+	FNetBitStreamReader* Reader = Context.GetBitStreamReader();
+	Target.TagNetIndex = Reader->ReadBits(GetTagNetIndexBits());
+	Target.FloatValueBits = Reader->ReadBits(GetValueBits(Target.TagNetIndex));
+}
+
+void FRockGameplayTagFloatNetSerializer::SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args)
+{
+	const FQuantizedType& Value = *reinterpret_cast<const FQuantizedType*>(Args.Source);
+	const FQuantizedType& PrevValue = *reinterpret_cast<const FQuantizedType*>(Args.Prev);
+
+	// Items rarely change their tag, usually only the value changed since the last acknowledged state
+	FNetBitStreamWriter* Writer = Context.GetBitStreamWriter();
+	if (Writer->WriteBool(Value.TagNetIndex != PrevValue.TagNetIndex))
+	{
+		Writer->WriteBits(Value.TagNetIndex, GetTagNetIndexBits());
+	}
+	if (Writer->WriteBool(Value.FloatValueBits != PrevValue.FloatValueBits))
+	{
+		Writer->WriteBits(Value.FloatValueBits, GetValueBits(Value.TagNetIndex));
+	}
+}
+
+void FRockGameplayTagFloatNetSerializer::DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args)
+{
+	FQuantizedType& Target = *reinterpret_cast<FQuantizedType*>(Args.Target);
+	const FQuantizedType& PrevValue = *reinterpret_cast<const FQuantizedType*>(Args.Prev);
+
+	FNetBitStreamReader* Reader = Context.GetBitStreamReader();
+	Target.TagNetIndex = Reader->ReadBool() ? Reader->ReadBits(GetTagNetIndexBits()) : PrevValue.TagNetIndex;
+	Target.FloatValueBits = Reader->ReadBool() ? Reader->ReadBits(GetValueBits(Target.TagNetIndex)) : PrevValue.FloatValueBits;
+}
+
+void FRockGameplayTagFloatNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	FQuantizedType& Target = *reinterpret_cast<FQuantizedType*>(Args.Target);
+
+	Target.TagNetIndex = UGameplayTagsManager::Get().GetNetIndexFromTag(Source.Tag);
+
+	const FRockTagFloatQuantization& Quantization = FRockGameplayTagFloat::GetNetQuantization(Source.Tag);
+	if (Quantization.IsEnabled())
+	{
+		Target.FloatValueBits = Quantization.Quantize(Source.FloatValue);
+	}
+	else
+	{
+		FMemory::Memcpy(&Target.FloatValueBits, &Source.FloatValue, sizeof(uint32));
+	}
+}
+
+void FRockGameplayTagFloatNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+{
+	const FQuantizedType& Source = *reinterpret_cast<const FQuantizedType*>(Args.Source);
+	SourceType& Target = *reinterpret_cast<SourceType*>(Args.Target);
+
+	// Only the replicated members are written, the fast array item state is owned by the fast array
+	Target.Tag = UGameplayTagsManager::Get().GetTagFromNetIndex(static_cast<FGameplayTagNetIndex>(Source.TagNetIndex));
+
+	const FRockTagFloatQuantization& Quantization = FRockGameplayTagFloat::GetNetQuantization(Target.Tag);
+	if (Quantization.IsEnabled())
+	{
+		Target.FloatValue = FRockGameplayTagFloat::DequantizeValue(Quantization, Source.FloatValueBits);
+	}
+	else
+	{
+		FMemory::Memcpy(&Target.FloatValue, &Source.FloatValueBits, sizeof(uint32));
+	}
+}
+
+bool FRockGameplayTagFloatNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+{
+	if (Args.bStateIsQuantized)
+	{
+		const FQuantizedType& Value0 = *reinterpret_cast<const FQuantizedType*>(Args.Source0);
+		const FQuantizedType& Value1 = *reinterpret_cast<const FQuantizedType*>(Args.Source1);
+		return Value0.TagNetIndex == Value1.TagNetIndex && Value0.FloatValueBits == Value1.FloatValueBits;
+	}
+
+	const SourceType& Value0 = *reinterpret_cast<const SourceType*>(Args.Source0);
+	const SourceType& Value1 = *reinterpret_cast<const SourceType*>(Args.Source1);
+	return Value0.Tag == Value1.Tag && Value0.FloatValue == Value1.FloatValue;
+}
+
+bool FRockGameplayTagFloatNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+
+	// Tags without a net index can't be replicated
+	return !Source.Tag.IsValid() || UGameplayTagsManager::Get().GetNetIndexFromTag(Source.Tag) != UGameplayTagsManager::Get().GetInvalidTagNetIndex();
+}
+
+static const FName PropertyNetSerializerRegistry_NAME_RockGameplayTagFloat("RockGameplayTagFloat");
+UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_RockGameplayTagFloat, FRockGameplayTagFloatNetSerializer);
+
+FRockGameplayTagFloatNetSerializer::FNetSerializerRegistryDelegates::~FNetSerializerRegistryDelegates()
+{
+	UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_RockGameplayTagFloat);
+}
+
+void FRockGameplayTagFloatNetSerializer::FNetSerializerRegistryDelegates::OnPreFreezeNetSerializerRegistry()
+{
+	UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_RockGameplayTagFloat);
+}
+
+}
+
+#endif
@@ -0,0 +1,24 @@
+// Copyright Broken Rock Studios LLC. All Rights Reserved.
+
+#pragma once
+
+#include "Iris/Serialization/NetSerializer.h"
+
+#include "RockGameplayTagFloatNetSerializer.generated.h"
+
+USTRUCT()
+struct FRockGameplayTagFloatNetSerializerConfig : public FNetSerializerConfig
+{
+	GENERATED_BODY()
+};
+
+namespace UE::Net
+{
+/**
+ * Iris serializer of FRockGameplayTagFloat, the items of FRockGameplayTagFloatContainer.
+ * Iris replicates the container as a regular fast array with per item dirtiness, this serializer keeps the items compact:
+ * tags are sent as their net index, values with the quantization of their tag (see FRockGameplayTagFloat::GetNetQuantization),
+ * and unchanged tags and values only cost a bit when delta serializing.
+ */
+UE_NET_DECLARE_SERIALIZER(FRockGameplayTagFloatNetSerializer, ROCKMODULARGAMEPLAYABILITIES_API);
+}
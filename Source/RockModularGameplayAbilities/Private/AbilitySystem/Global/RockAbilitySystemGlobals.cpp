@@ -3,10 +3,16 @@
 
 #include "AbilitySystem/Global/RockAbilitySystemGlobals.h"
 
+#include "AbilitySystemComponent.h"
 #include "AbilitySystem/RockGameplayEffectContext.h"
 #include "AbilitySystem/Attributes/RockAttributeChangeInfo.h"
 #include "AbilitySystem/Attributes/RockAttributeSet.h"
 #include "AbilitySystem/Attributes/RockAttributeSetInitter.h"
+#include "Engine/CurveTable.h"
+#include "Hash/xxhash.h"
+#include "Logging/RockLogging.h"
+#include "Misc/App.h"
+#include "Misc/Paths.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(RockAbilitySystemGlobals)
 
@@ -20,9 +26,106 @@ TSharedPtr<FRockAttributeChangeInfo> URockAbilitySystemGlobals::AllocRockAttribu
 	return MakeShared<FRockAttributeChangeInfo>();
 }
 
+FRockAttributeChangeInfoHandle URockAbilitySystemGlobals::AllocPooledRockAttributeChangeInfo() const
+{
+	if (!AttributeChangeInfoPool)
+	{
+		// A pool of size 0 frees every released info, so infos are still handed out without a separate reference controller
+		AttributeChangeInfoPool = MakeShared<FRockAttributeChangeInfoPool, ESPMode::ThreadSafe>(FMath::Max(AttributeChangeInfoPoolSize, 0));
+	}
+	return AttributeChangeInfoPool->Alloc();
+}
+
 void URockAbilitySystemGlobals::AllocAttributeSetInitter()
 {
-	GlobalAttributeSetInitter = MakeShared<FRockAttributeSetInitter>();
+	GlobalAttributeSetInitter = MakeShared<FRockAttributeSetInitter>(bInterpolateAttributeDefaults, AttributeDefaultsSamplesPerLevel, bInitAttributeDefaultsDirectly);
+}
+
+void URockAbilitySystemGlobals::InitAttributeDefaults()
+{
+	const bool bUseCache = bCacheAttributeDefaults && !GIsEditor;
+	if (bUseCache)
+	{
+		AllocAttributeSetInitter();
+		if (GetRockAttributeSetInitter()->LoadDefaultsCache(GetAttributeDefaultsCacheFilename(), GetAttributeDefaultsSourceStamp()))
+		{
+			// The curve tables are only hashed to validate the cache, their curves are not sampled
+			return;
+		}
+	}
+
+	Super::InitAttributeDefaults();
+
+	if (bUseCache && GetAttributeSetInitter())
+	{
+		GetRockAttributeSetInitter()->SaveDefaultsCache(GetAttributeDefaultsCacheFilename(), GetAttributeDefaultsSourceStamp());
+	}
+}
+
+uint64 URockAbilitySystemGlobals::GetAttributeDefaultsSourceStamp() const
+{
+	FXxHash64Builder StampBuilder;
+	auto AppendToStamp = [&StampBuilder](const auto& Value) { StampBuilder.Update(&Value, sizeof(Value)); };
+	auto AppendStringToStamp = [&StampBuilder](const FString& String) { StampBuilder.Update(*String, String.Len() * sizeof(TCHAR)); };
+
+	// Class and attribute layouts can change with any build
+	AppendStringToStamp(FApp::GetBuildVersion());
+	AppendToStamp(bInterpolateAttributeDefaults);
+	AppendToStamp(AttributeDefaultsSamplesPerLevel);
+
+	for (const FSoftObjectPath& TablePath : GetGlobalAttributeSetDefaultsTablePaths())
+	{
+		AppendStringToStamp(TablePath.ToString());
+
+		// Hash the curve data itself, package file stats aren't available in pak or IoStore builds
+		const UCurveTable* CurveTable = Cast<UCurveTable>(TablePath.TryLoad());
+		if (!CurveTable)
+		{
+			continue;
+		}
+
+		const ECurveTableMode CurveTableMode = CurveTable->GetCurveTableMode();
+		AppendToStamp(CurveTableMode);
+		if (CurveTableMode == ECurveTableMode::SimpleCurves)
+		{
+			for (const TPair<FName, FSimpleCurve*>& Row : CurveTable->GetSimpleCurveRowMap())
+			{
+				AppendStringToStamp(Row.Key.ToString());
+				AppendToStamp(Row.Value->GetKeyInterpMode());
+				for (const FSimpleCurveKey& Key : Row.Value->GetConstRefOfKeys())
+				{
+					AppendToStamp(Key.Time);
+					AppendToStamp(Key.Value);
+				}
+			}
+		}
+		else
+		{
+			for (const TPair<FName, FRichCurve*>& Row : CurveTable->GetRichCurveRowMap())
+			{
+				AppendStringToStamp(Row.Key.ToString());
+				for (const FRichCurveKey& Key : Row.Value->GetConstRefOfKeys())
+				{
+					AppendToStamp(Key.InterpMode);
+					AppendToStamp(Key.TangentMode);
+					AppendToStamp(Key.TangentWeightMode);
+					AppendToStamp(Key.Time);
+					AppendToStamp(Key.Value);
+					AppendToStamp(Key.ArriveTangent);
+					AppendToStamp(Key.ArriveTangentWeight);
+					AppendToStamp(Key.LeaveTangent);
+					AppendToStamp(Key.LeaveTangentWeight);
+				}
+			}
+		}
+	}
+
+	return StampBuilder.Finalize().Hash;
+}
+
+FString URockAbilitySystemGlobals::GetAttributeDefaultsCacheFilename() const
+{
+	return FPaths::ProjectSavedDir() / TEXT("RockAbilitySystem") / TEXT("AttributeDefaults.bin");
 }
 
 FRockAttributeSetInitter* URockAbilitySystemGlobals::GetRockAttributeSetInitter() const
@@ -31,50 +134,335 @@ FRockAttributeSetInitter* URockAbilitySystemGlobals::GetRockAttributeSetInitter(
 
 }
 
+int32 URockAbilitySystemGlobals::ResolveAttributeInitGroup(const FRockAttributeInitializationKey& Key, bool bAllowFallback) const
+{
+	const FRockAttributeSetInitter* Initter = GetRockAttributeSetInitter();
+	if (Key.CachedGroupGeneration != Initter->GetGeneration())
+	{
+		bool bIsFallback = false;
+		Key.CachedGroupIndex = Initter->ResolveGroupIndex(Key.GetAttributeInitGroupName(), bIsFallback);
+		Key.bCachedGroupIsFallback = bIsFallback;
+		Key.CachedGroupGeneration = Initter->GetGeneration();
+	}
+	return bAllowFallback || !Key.bCachedGroupIsFallback ? Key.CachedGroupIndex : INDEX_NONE;
+}
+
 void URockAbilitySystemGlobals::InitAttributeSetDefaults(
 	UAbilitySystemComponent* AbilitySystemComponent, const FRockAttributeInitializationKey& Key, int32 Level, bool bInitialInit) const
+{
+	InitAttributeSetDefaultsInterpolated(AbilitySystemComponent, Key, static_cast<float>(Level), bInitialInit);
+}
+
+void URockAbilitySystemGlobals::ApplyAttributeSetDefaults(
+	UAbilitySystemComponent* AbilitySystemComponent, FGameplayAttribute& InAttribute, const FRockAttributeInitializationKey& Key, int32 Level) const
 {
 	if (ensure(Key.IsValid()))
 	{
-		FName GroupName = Key.GetAttributeInitCategory();
-		if (!Key.GetAttributeInitSubCategory().IsNone())
+		const int32 GroupIndex = ResolveAttributeInitGroup(Key, true);
+		if (GroupIndex != INDEX_NONE)
 		{
-			GroupName = FName(*FString::Printf(TEXT("%s.%s"), *Key.GetAttributeInitCategory().ToString(), *Key.GetAttributeInitSubCategory().ToString()));
+			GetRockAttributeSetInitter()->ApplyAttributeDefaultForGroup(AbilitySystemComponent, InAttribute, GroupIndex, Level);
 		}
-		GetRockAttributeSetInitter()->InitAttributeSetDefaults(AbilitySystemComponent, GroupName, Level, bInitialInit);
 	}
 }
 
-void URockAbilitySystemGlobals::ApplyAttributeSetDefaults(
-	UAbilitySystemComponent* AbilitySystemComponent, FGameplayAttribute& InAttribute, const FRockAttributeInitializationKey& Key, int32 Level) const
+TArray<float> URockAbilitySystemGlobals::GetAttributeSetValues(
+	UClass* AttributeSetClass, FProperty* AttributeProperty, const FRockAttributeInitializationKey& Key) const
 {
 	if (ensure(Key.IsValid()))
 	{
-		FName GroupName = Key.GetAttributeInitCategory();
-		if (!Key.GetAttributeInitSubCategory().IsNone())
+		// Values are only reported for the exact group, like FAttributeSetInitter::GetAttributeSetValues
+		const int32 GroupIndex = ResolveAttributeInitGroup(Key, false);
+		if (GroupIndex != INDEX_NONE)
 		{
-			GroupName = FName(*FString::Printf(TEXT("%s.%s"), *Key.GetAttributeInitCategory().ToString(), *Key.GetAttributeInitSubCategory().ToString()));
+			return GetRockAttributeSetInitter()->GetAttributeSetValuesForGroup(AttributeSetClass, AttributeProperty, GroupIndex);
 		}
-		GetRockAttributeSetInitter()->ApplyAttributeDefault(AbilitySystemComponent, InAttribute, GroupName, Level);
 	}
+	return {};
 }
 
-TArray<float> URockAbilitySystemGlobals::GetAttributeSetValues(
-	UClass* AttributeSetClass, FProperty* AttributeProperty, const FRockAttributeInitializationKey& Key) const
+TConstArrayView<float> URockAbilitySystemGlobals::GetAttributeSetValuesView(
+	const UClass* AttributeSetClass, const FProperty* AttributeProperty, const FRockAttributeInitializationKey& Key) const
 {
 	if (ensure(Key.IsValid()))
 	{
-		FName GroupName = Key.GetAttributeInitCategory();
-		if (!Key.GetAttributeInitSubCategory().IsNone())
+		const int32 GroupIndex = ResolveAttributeInitGroup(Key, false);
+		if (GroupIndex != INDEX_NONE)
 		{
-			GroupName = FName(*FString::Printf(TEXT("%s.%s"), *Key.GetAttributeInitCategory().ToString(), *Key.GetAttributeInitSubCategory().ToString()));
+			return GetRockAttributeSetInitter()->GetAttributeSetValuesViewForGroup(AttributeSetClass, AttributeProperty, GroupIndex);
 		}
-		return GetRockAttributeSetInitter()->GetAttributeSetValues(AttributeSetClass, AttributeProperty, GroupName);
 	}
 	return {};
 }
 
+void URockAbilitySystemGlobals::InitAttributeSetDefaultsInterpolated(
+	UAbilitySystemComponent* AbilitySystemComponent, const FRockAttributeInitializationKey& Key, float Level, bool bInitialInit) const
+{
+	if (ensure(Key.IsValid()))
+	{
+		const int32 GroupIndex = ResolveAttributeInitGroup(Key, true);
+		if (GroupIndex != INDEX_NONE)
+		{
+			const FRockAttributeSetInitter* Initter = GetRockAttributeSetInitter();
+			Initter->InitAttributeSetDefaultsForGroup(AbilitySystemComponent, GroupIndex, Level, bInitialInit);
+			TrackAttributeDefaultsTarget(AbilitySystemComponent, Initter->GetGroupName(GroupIndex), Level);
+		}
+	}
+}
+
+void URockAbilitySystemGlobals::ApplyLevelTransition(
+	UAbilitySystemComponent* AbilitySystemComponent, const FRockAttributeInitializationKey& Key, int32 FromLevel, int32 ToLevel) const
+{
+	if (ensure(Key.IsValid()))
+	{
+		const int32 GroupIndex = ResolveAttributeInitGroup(Key, true);
+		if (GroupIndex != INDEX_NONE)
+		{
+			const FRockAttributeSetInitter* Initter = GetRockAttributeSetInitter();
+			Initter->ApplyLevelTransitionForGroup(AbilitySystemComponent, GroupIndex, FromLevel, ToLevel);
+			TrackAttributeDefaultsTarget(AbilitySystemComponent, Initter->GetGroupName(GroupIndex), ToLevel);
+		}
+	}
+}
+
+void URockAbilitySystemGlobals::InitAttributeSetDefaultsBatch(TConstArrayView<FRockAttributeInitializationRequest> Requests, bool bInitialInit) const
+{
+	const FRockAttributeSetInitter* Initter = GetRockAttributeSetInitter();
+
+	TArray<FRockAttributeDefaultsInitRequest> InitterRequests;
+	InitterRequests.Reserve(Requests.Num());
+
+	// Spawn waves share a handful of keys, resolve each of them once
+	TMap<TPair<FName, FName>, int32> GroupIndexByKey;
+	for (const FRockAttributeInitializationRequest& Request : Requests)
+	{
+		if (!Request.AbilitySystemComponent || !ensure(Request.Key.IsValid()))
+		{
+			continue;
+		}
+
+		const TPair<FName, FName> KeyNames(Request.Key.GetAttributeInitCategory(), Request.Key.GetAttributeInitSubCategory());
+		const int32* GroupIndex = GroupIndexByKey.Find(KeyNames);
+		if (!GroupIndex)
+		{
+			GroupIndex = &GroupIndexByKey.Add(KeyNames, ResolveAttributeInitGroup(Request.Key, true));
+		}
+
+		if (*GroupIndex != INDEX_NONE)
+		{
+			InitterRequests.Add({ Request.AbilitySystemComponent, *GroupIndex, Request.Level });
+			TrackAttributeDefaultsTarget(Request.AbilitySystemComponent, Initter->GetGroupName(*GroupIndex), Request.Level);
+		}
+	}
+
+	Initter->InitAttributeSetDefaultsBatch(InitterRequests, bInitialInit);
+}
+
 void URockAbilitySystemGlobals::ReloadAttributeDefaults()
 {
+	LoadAttributeDefaultsTables();
 	Super::ReloadAttributeDefaults();
 }
+
+void URockAbilitySystemGlobals::ReloadAttributeDefaultsForTables(const TArray<UCurveTable*>& ChangedTables, bool bPushToLiveASCs)
+{
+	LoadAttributeDefaultsTables();
+
+	FRockAttributeSetInitter* Initter = GetRockAttributeSetInitter();
+	if (!Initter || GlobalAttributeDefaultsTables.IsEmpty())
+	{
+		return;
+	}
+
+	UE_CLOG(bPushToLiveASCs && !bTrackAttributeDefaultsTargets, LogRockAbilitySystem, Warning, TEXT("ReloadAttributeDefaultsForTables: bTrackAttributeDefaultsTargets is off, no live ASCs to push the reloaded defaults to"));
+
+	// Remember the defaults every tracked set has now, so only the base values the reload changes are pushed
+	TMap<FAttributeDefaultsSetKey, TArray<FRockAttributeDefaultValue>> OldDefaults;
+	if (bPushToLiveASCs)
+	{
+		PruneAttributeDefaultsTargets();
+		TArray<FName> TrackedGroups;
+		for (const TPair<TWeakObjectPtr<UAbilitySystemComponent>, FAttributeDefaultsTarget>& Target : AttributeDefaultsTargets)
+		{
+			TrackedGroups.AddUnique(Target.Value.GroupName);
+		}
+		GatherTrackedAttributeDefaults(TrackedGroups, OldDefaults);
+	}
+
+	TArray<FName> ReloadedGroups;
+	Initter->ReloadCurveTables(ToRawPtrTArrayUnsafe(GlobalAttributeDefaultsTables), ChangedTables, ReloadedGroups);
+
+	if (!bPushToLiveASCs || ReloadedGroups.IsEmpty())
+	{
+		return;
+	}
+
+	TMap<FAttributeDefaultsSetKey, TArray<FRockAttributeDefaultValue>> NewDefaults;
+	GatherTrackedAttributeDefaults(ReloadedGroups, NewDefaults);
+
+	bool bAnyDefaultChanged = false;
+	for (const TPair<FAttributeDefaultsSetKey, TArray<FRockAttributeDefaultValue>>& SetDefaults : NewDefaults)
+	{
+		const TArray<FRockAttributeDefaultValue>* OldSetDefaults = OldDefaults.Find(SetDefaults.Key);
+		for (const FRockAttributeDefaultValue& NewDefault : SetDefaults.Value)
+		{
+			const FRockAttributeDefaultValue* OldDefault = OldSetDefaults ? OldSetDefaults->FindByPredicate([&NewDefault](const FRockAttributeDefaultValue& Default)
+			{
+				return Default.Property == NewDefault.Property;
+			}) : nullptr;
+
+			if (OldDefault && OldDefault->Value == NewDefault.Value)
+			{
+				continue;
+			}
+
+			// Merge with changes of earlier reloads that weren't pushed yet, the latest value wins
+			TArray<FRockAttributeDefaultValue>& PendingChanges = PendingAttributeDefaultChanges.FindOrAdd(SetDefaults.Key);
+			if (FRockAttributeDefaultValue* PendingChange = PendingChanges.FindByPredicate([&NewDefault](const FRockAttributeDefaultValue& Default)
+			{
+				return Default.Property == NewDefault.Property;
+			}))
+			{
+				PendingChange->Value = NewDefault.Value;
+			}
+			else
+			{
+				PendingChanges.Add(NewDefault);
+			}
+			bAnyDefaultChanged = true;
+		}
+	}
+
+	if (!bAnyDefaultChanged)
+	{
+		return;
+	}
+
+	for (const TPair<TWeakObjectPtr<UAbilitySystemComponent>, FAttributeDefaultsTarget>& Target : AttributeDefaultsTargets)
+	{
+		if (ReloadedGroups.Contains(Target.Value.GroupName))
+		{
+			PendingAttributeDefaultsPushes.AddUnique(Target.Key);
+		}
+	}
+
+	if (!PendingAttributeDefaultsPushes.IsEmpty() && !AttributeDefaultsPushTickerHandle.IsValid())
+	{
+		AttributeDefaultsPushTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickAttributeDefaultsPush));
+	}
+}
+
+void URockAbilitySystemGlobals::LoadAttributeDefaultsTables()
+{
+	if (!GlobalAttributeDefaultsTables.IsEmpty())
+	{
+		return;
+	}
+
+	for (const FSoftObjectPath& TablePath : GetGlobalAttributeSetDefaultsTablePaths())
+	{
+		if (UCurveTable* CurveTable = Cast<UCurveTable>(TablePath.TryLoad()))
+		{
+			GlobalAttributeDefaultsTables.Add(CurveTable);
+		}
+	}
+}
+
+void URockAbilitySystemGlobals::TrackAttributeDefaultsTarget(UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, float Level) const
+{
+	if (bTrackAttributeDefaultsTargets)
+	{
+		AttributeDefaultsTargets.Add(AbilitySystemComponent, { GroupName, Level });
+		if (AttributeDefaultsTargets.Num() >= AttributeDefaultsTargetsPruneSize)
+		{
+			PruneAttributeDefaultsTargets();
+		}
+	}
+}
+
+void URockAbilitySystemGlobals::UntrackAttributeDefaultsTarget(const UAbilitySystemComponent* AbilitySystemComponent)
+{
+	if (!AttributeDefaultsTargets.IsEmpty())
+	{
+		AttributeDefaultsTargets.Remove(MakeWeakObjectPtr(const_cast<UAbilitySystemComponent*>(AbilitySystemComponent)));
+	}
+}
+
+void URockAbilitySystemGlobals::PruneAttributeDefaultsTargets() const
+{
+	for (auto TargetIt = AttributeDefaultsTargets.CreateIterator(); TargetIt; ++TargetIt)
+	{
+		if (!TargetIt->Key.IsValid())
+		{
+			TargetIt.RemoveCurrent();
+		}
+	}
+
+	// Only prune again once the live targets have doubled, so tracking stays amortized O(1)
+	AttributeDefaultsTargetsPruneSize = FMath::Max(64, AttributeDefaultsTargets.Num() * 2);
+}
+
+void URockAbilitySystemGlobals::GatherTrackedAttributeDefaults(const TArray<FName>& Groups, TMap<FAttributeDefaultsSetKey, TArray<FRockAttributeDefaultValue>>& OutDefaults) const
+{
+	const FRockAttributeSetInitter* Initter = GetRockAttributeSetInitter();
+	for (const TPair<TWeakObjectPtr<UAbilitySystemComponent>, FAttributeDefaultsTarget>& Target : AttributeDefaultsTargets)
+	{
+		const UAbilitySystemComponent* AbilitySystemComponent = Target.Key.Get();
+		if (!AbilitySystemComponent || !Groups.Contains(Target.Value.GroupName))
+		{
+			continue;
+		}
+
+		for (const UAttributeSet* Set : AbilitySystemComponent->GetSpawnedAttributes())
+		{
+			const FAttributeDefaultsSetKey Key(Target.Value.GroupName, Target.Value.Level, Set ? Set->GetClass() : nullptr);
+			if (Set && !OutDefaults.Contains(Key))
+			{
+				Initter->GetAttributeSetDefaults(Target.Value.GroupName, Set->GetClass(), Target.Value.Level, OutDefaults.Add(Key));
+			}
+		}
+	}
+}
+
+bool URockAbilitySystemGlobals::TickAttributeDefaultsPush(float DeltaTime)
+{
+	const int32 NumPushes = FMath::Min(PendingAttributeDefaultsPushes.Num(), AttributeDefaultsPushBudgetPerFrame);
+	for (int32 PushIndex = 0; PushIndex < NumPushes; ++PushIndex)
+	{
+		UAbilitySystemComponent* AbilitySystemComponent = PendingAttributeDefaultsPushes[PushIndex].Get();
+		const FAttributeDefaultsTarget* Target = AttributeDefaultsTargets.Find(AbilitySystemComponent);
+		if (!AbilitySystemComponent || !Target)
+		{
+			continue;
+		}
+
+		// Only the changed base values are written, current values of every other attribute are left alone
+		FScopedAggregatorOnDirtyBatch AggregatorBatch;
+		for (UAttributeSet* Set : AbilitySystemComponent->GetSpawnedAttributes())
+		{
+			const TArray<FRockAttributeDefaultValue>* Changes = Set ? PendingAttributeDefaultChanges.Find(FAttributeDefaultsSetKey(Target->GroupName, Target->Level, Set->GetClass())) : nullptr;
+			if (!Changes)
+			{
+				continue;
+			}
+
+			for (const FRockAttributeDefaultValue& Change : *Changes)
+			{
+				// Not an initial init, so sets can keep attributes they don't want reset
+				if (Set->ShouldInitProperty(false, Change.Property))
+				{
+					AbilitySystemComponent->SetNumericAttributeBase(FGameplayAttribute(Change.Property), Change.Value);
+				}
+			}
+		}
+	}
+	PendingAttributeDefaultsPushes.RemoveAt(0, NumPushes);
+
+	if (PendingAttributeDefaultsPushes.IsEmpty())
+	{
+		PendingAttributeDefaultChanges.Reset();
+		AttributeDefaultsPushTickerHandle.Reset();
+		return false;
+	}
+	return true;
+}
@@ -5,6 +5,11 @@
 #include "AbilitySystem/RockGameplayEffectContext.h"
 
 #include "AbilitySystem/RockAbilitySourceInterface.h"
+#include "HAL/PlatformMemory.h"
+#include "Logging/RockLogging.h"
+#include "Misc/ScopeLock.h"
+
+#include <atomic>
 
 #if UE_WITH_IRIS
 #include "Iris/ReplicationState/PropertyNetSerializerInfoRegistry.h"
@@ -13,6 +18,286 @@
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(RockGameplayEffectContext)
 
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Effect Contexts In Use"), STAT_RockEffectContextsInUse, STATGROUP_RockAbilitySystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Effect Contexts High Water Mark"), STAT_RockEffectContextsHighWaterMark, STATGROUP_RockAbilitySystem);
+DECLARE_MEMORY_STAT(TEXT("Effect Context Slab Memory"), STAT_RockEffectContextSlabMemory, STATGROUP_RockAbilitySystem);
+
+namespace RockGameplayEffectContext
+{
+	class FSlabAllocator;
+	static FSlabAllocator& GetSlabAllocator();
+
+	// Set once the thread's slot cache is destroyed. Trivially destructible, so it can still be read after that
+	static thread_local bool bThreadCacheDestroyed = false;
+
+	/**
+	 * Hands out fixed size slots for FRockGameplayEffectContext from slabs of consecutive slots, so contexts don't hit the
+	 * general heap and contexts created together sit close together. Slabs are committed from a single address range
+	 * reserved up front, which lets Owns() tell slab slots from heap blocks with a range check. Contexts past the
+	 * reservation come from the heap.
+	 *
+	 * Each thread keeps a small cache of free slots and only takes the lock to move slots in batches between its cache
+	 * and the shared free list.
+	 */
+	class FSlabAllocator
+	{
+	public:
+		static constexpr SIZE_T SlotAlignment = FMath::Max<SIZE_T>(alignof(FRockGameplayEffectContext), alignof(void*));
+		static constexpr SIZE_T SlotSize = Align(sizeof(FRockGameplayEffectContext), SlotAlignment);
+		static constexpr int32 SlotsPerSlab = 64;
+		static constexpr SIZE_T ReservedSize = 64 * 1024 * 1024;
+		// Free slots a thread keeps for itself, half of them go back to the shared list once it holds more
+		static constexpr int32 MaxCachedSlots = 32;
+		static constexpr int32 SlotsPerBatch = MaxCachedSlots / 2;
+
+		FSlabAllocator()
+		{
+			VirtualBlock = FPlatformMemory::FPlatformVirtualMemoryBlock::AllocateVirtual(ReservedSize);
+			RangeBegin = static_cast<uint8*>(VirtualBlock.GetVirtualPointer());
+			RangeEnd = RangeBegin ? RangeBegin + VirtualBlock.GetActualSize() : nullptr;
+			SlabSize = Align(SlotSize * SlotsPerSlab, FPlatformMemory::FPlatformVirtualMemoryBlock::GetCommitAlignment());
+		}
+
+		/** True if Ptr is a slot handed out by this allocator, anything else belongs to the heap */
+		bool Owns(const void* Ptr) const
+		{
+			return Ptr >= RangeBegin && Ptr < RangeEnd;
+		}
+
+		/** Returns nullptr once the reserved range is used up */
+		void* Alloc()
+		{
+			if (bThreadCacheDestroyed)
+			{
+				// Thread is shutting down, go straight to the shared list
+				FScopeLock Lock(&FreeSlotsLock);
+				FFreeSlot* Slot = PopSharedSlot();
+				if (Slot)
+				{
+					OnSlotAllocated();
+				}
+				return Slot;
+			}
+
+			FThreadCache& Cache = GetThreadCache();
+			if (!Cache.FreeSlots)
+			{
+				RefillCache(Cache);
+			}
+
+			FFreeSlot* Slot = Cache.FreeSlots;
+			if (!Slot)
+			{
+				return nullptr;
+			}
+			Cache.FreeSlots = Slot->Next;
+			--Cache.NumSlots;
+
+			OnSlotAllocated();
+			return Slot;
+		}
+
+		void Free(void* Ptr)
+		{
+			check(Owns(Ptr));
+			FFreeSlot* Slot = static_cast<FFreeSlot*>(Ptr);
+			OnSlotFreed();
+
+			if (bThreadCacheDestroyed)
+			{
+				FScopeLock Lock(&FreeSlotsLock);
+				Slot->Next = FreeSlots;
+				FreeSlots = Slot;
+				return;
+			}
+
+			FThreadCache& Cache = GetThreadCache();
+			Slot->Next = Cache.FreeSlots;
+			Cache.FreeSlots = Slot;
+			if (++Cache.NumSlots > MaxCachedSlots)
+			{
+				ReturnSlots(Cache, SlotsPerBatch);
+			}
+		}
+
+		int32 GetHighWaterMark() const
+		{
+			return HighWaterMark.load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct FFreeSlot
+		{
+			FFreeSlot* Next;
+		};
+
+		struct FThreadCache
+		{
+			FFreeSlot*	FreeSlots = nullptr;
+			int32		NumSlots = 0;
+
+			~FThreadCache()
+			{
+				// Contexts released on this thread from here on use the shared list directly
+				GetSlabAllocator().ReturnSlots(*this, NumSlots);
+				bThreadCacheDestroyed = true;
+			}
+		};
+
+		static FThreadCache& GetThreadCache()
+		{
+			static thread_local FThreadCache Cache;
+			return Cache;
+		}
+
+		void OnSlotAllocated()
+		{
+			const int32 InUse = NumInUse.fetch_add(1, std::memory_order_relaxed) + 1;
+			int32 PrevHighWaterMark = HighWaterMark.load(std::memory_order_relaxed);
+			while (InUse > PrevHighWaterMark)
+			{
+				if (HighWaterMark.compare_exchange_weak(PrevHighWaterMark, InUse, std::memory_order_relaxed))
+				{
+					SET_DWORD_STAT(STAT_RockEffectContextsHighWaterMark, InUse);
+					break;
+				}
+			}
+			INC_DWORD_STAT(STAT_RockEffectContextsInUse);
+		}
+
+		void OnSlotFreed()
+		{
+			NumInUse.fetch_sub(1, std::memory_order_relaxed);
+			DEC_DWORD_STAT(STAT_RockEffectContextsInUse);
+		}
+
+		void RefillCache(FThreadCache& Cache)
+		{
+			FScopeLock Lock(&FreeSlotsLock);
+			for (int32 Count = 0; Count < SlotsPerBatch; ++Count)
+			{
+				FFreeSlot* Slot = PopSharedSlot();
+				if (!Slot)
+				{
+					break;
+				}
+				Slot->Next = Cache.FreeSlots;
+				Cache.FreeSlots = Slot;
+				++Cache.NumSlots;
+			}
+		}
+
+		void ReturnSlots(FThreadCache& Cache, int32 Count)
+		{
+			if (Count <= 0)
+			{
+				return;
+			}
+
+			FScopeLock Lock(&FreeSlotsLock);
+			while (Count-- > 0 && Cache.FreeSlots)
+			{
+				FFreeSlot* Slot = Cache.FreeSlots;
+				Cache.FreeSlots = Slot->Next;
+				--Cache.NumSlots;
+
+				Slot->Next = FreeSlots;
+				FreeSlots = Slot;
+			}
+		}
+
+		/** Caller holds FreeSlotsLock */
+		FFreeSlot* PopSharedSlot()
+		{
+			if (!FreeSlots && !AddSlab())
+			{
+				return nullptr;
+			}
+
+			FFreeSlot* Slot = FreeSlots;
+			FreeSlots = Slot->Next;
+			return Slot;
+		}
+
+		/** Caller holds FreeSlotsLock */
+		bool AddSlab()
+		{
+			if (!RangeBegin || CommittedSize + SlabSize > static_cast<SIZE_T>(RangeEnd - RangeBegin))
+			{
+				return false;
+			}
+
+			VirtualBlock.Commit(CommittedSize, SlabSize);
+			uint8* Slab = RangeBegin + CommittedSize;
+			CommittedSize += SlabSize;
+			INC_MEMORY_STAT_BY(STAT_RockEffectContextSlabMemory, SlabSize);
+
+			// Push in reverse, so the slots are handed out in address order
+			const int32 NumSlots = static_cast<int32>(SlabSize / SlotSize);
+			for (int32 SlotIndex = NumSlots - 1; SlotIndex >= 0; --SlotIndex)
+			{
+				FFreeSlot* Slot = reinterpret_cast<FFreeSlot*>(Slab + SlotIndex * SlotSize);
+				Slot->Next = FreeSlots;
+				FreeSlots = Slot;
+			}
+			return true;
+		}
+
+		FPlatformMemory::FPlatformVirtualMemoryBlock VirtualBlock;
+		uint8*				RangeBegin = nullptr;
+		uint8*				RangeEnd = nullptr;
+		SIZE_T				SlabSize = 0;
+		SIZE_T				CommittedSize = 0;
+
+		FCriticalSection	FreeSlotsLock;
+		FFreeSlot*			FreeSlots = nullptr;
+		std::atomic<int32>	NumInUse = 0;
+		std::atomic<int32>	HighWaterMark = 0;
+	};
+
+	static FSlabAllocator& GetSlabAllocator()
+	{
+		// Never destroyed, contexts may still be released during static destruction
+		static FSlabAllocator* Allocator = new FSlabAllocator();
+		return *Allocator;
+	}
+}
+
+void* FRockGameplayEffectContext::operator new(size_t Size)
+{
+	if (Size == sizeof(FRockGameplayEffectContext))
+	{
+		if (void* Slot = RockGameplayEffectContext::GetSlabAllocator().Alloc())
+		{
+			return Slot;
+		}
+	}
+	return FMemory::Malloc(Size, alignof(FRockGameplayEffectContext));
+}
+
+void FRockGameplayEffectContext::operator delete(void* Ptr, size_t Size)
+{
+	if (!Ptr)
+	{
+		return;
+	}
+
+	// Contexts created through the struct ops (FMemory::Malloc and InitializeStruct) are deleted through here too, so
+	// only slots from the slab range go back to the slab
+	RockGameplayEffectContext::FSlabAllocator& Allocator = RockGameplayEffectContext::GetSlabAllocator();
+	if (Allocator.Owns(Ptr))
+	{
+		Allocator.Free(Ptr);
+		return;
+	}
+	FMemory::Free(Ptr);
+}
+
+int32 FRockGameplayEffectContext::GetSlabHighWaterMark()
+{
+	return RockGameplayEffectContext::GetSlabAllocator().GetHighWaterMark();
+}
+
 
 FRockGameplayEffectContext* FRockGameplayEffectContext::ExtractEffectContext(struct FGameplayEffectContextHandle Handle)
 {
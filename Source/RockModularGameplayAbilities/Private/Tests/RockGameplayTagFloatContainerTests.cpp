@@ -0,0 +1,173 @@
+// Copyright Broken Rock Studios LLC. All Rights Reserved.
+// See the LICENSE file for details.
+
+#include "AbilitySystem/Containers/RockGameplayTagFloatContainer.h"
+
+#include "Misc/AutomationTest.h"
+#include "NativeGameplayTags.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace RockGameplayTagFloatContainerTests
+{
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_Test_Parent, "Test.RockTagFloat");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_Test_A, "Test.RockTagFloat.A");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_Test_B, "Test.RockTagFloat.B");
+
+	enum class EOp : uint8
+	{
+		Add,
+		Set,
+		Subtract,
+		Remove
+	};
+
+	struct FOp
+	{
+		EOp				Op;
+		FGameplayTag	Tag;
+		float			Value = 0.f;
+	};
+
+	struct FScenario
+	{
+		const TCHAR*	Name;
+		// Applied to the container before the ops under test
+		TArray<FOp>		Setup;
+		TArray<FOp>		Ops;
+	};
+
+	void ApplySequential(FRockGameplayTagFloatContainer& Container, TConstArrayView<FOp> Ops)
+	{
+		for (const FOp& Op : Ops)
+		{
+			switch (Op.Op)
+			{
+			case EOp::Add:		Container.AddFloat(Op.Tag, Op.Value); break;
+			case EOp::Set:		Container.SetFloat(Op.Tag, Op.Value); break;
+			case EOp::Subtract:	Container.SubtractFloat(Op.Tag, Op.Value); break;
+			case EOp::Remove:	Container.RemoveTag(Op.Tag); break;
+			}
+		}
+	}
+
+	void ApplyBatch(FRockGameplayTagFloatContainer& Container, TConstArrayView<FOp> Ops)
+	{
+		FRockGameplayTagFloatBatchEdit Batch(Container);
+		for (const FOp& Op : Ops)
+		{
+			switch (Op.Op)
+			{
+			case EOp::Add:		Batch.AddFloat(Op.Tag, Op.Value); break;
+			case EOp::Set:		Batch.SetFloat(Op.Tag, Op.Value); break;
+			case EOp::Subtract:	Batch.SubtractFloat(Op.Tag, Op.Value); break;
+			case EOp::Remove:	Batch.RemoveTag(Op.Tag); break;
+			}
+		}
+		Batch.Commit();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRockGameplayTagFloatBatchEditTest, "RockModularGameplayAbilities.TagFloatContainer.BatchEditMatchesSequential",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRockGameplayTagFloatBatchEditTest::RunTest(const FString& Parameters)
+{
+	using namespace RockGameplayTagFloatContainerTests;
+
+	const FGameplayTag A = TAG_Test_A;
+	const FGameplayTag B = TAG_Test_B;
+	const TArray<FScenario> Scenarios =
+	{
+		{ TEXT("Subtract then add on a missing tag"), {}, { { EOp::Subtract, A, 2.f }, { EOp::Add, A, 1.f } } },
+		{ TEXT("Subtract past zero then add"), { { EOp::Set, A, 3.f } }, { { EOp::Subtract, A, 5.f }, { EOp::Add, A, 4.f } } },
+		{ TEXT("Remove then add"), { { EOp::Set, A, 3.f } }, { { EOp::Remove, A }, { EOp::Add, A, 2.f } } },
+		{ TEXT("Set, subtract all, add"), { { EOp::Set, A, 3.f } }, { { EOp::Set, A, 1.f }, { EOp::Subtract, A, 1.f }, { EOp::Add, A, 5.f } } },
+		{ TEXT("Add and subtract on a missing tag"), {}, { { EOp::Add, A, 1.f }, { EOp::Subtract, A, 0.5f }, { EOp::Subtract, A, 1.f }, { EOp::Add, A, 2.f } } },
+		{ TEXT("Subtract down to removal"), { { EOp::Set, A, 2.f } }, { { EOp::Subtract, A, 1.f }, { EOp::Subtract, A, 1.f }, { EOp::Subtract, A, 1.f } } },
+		{ TEXT("Partial subtract"), { { EOp::Set, A, 3.f } }, { { EOp::Subtract, A, 1.25f }, { EOp::Add, A, 0.5f } } },
+		{ TEXT("Several tags"), { { EOp::Set, A, 1.f }, { EOp::Set, B, 2.f } }, { { EOp::Subtract, B, 2.f }, { EOp::Set, A, 4.f }, { EOp::Add, B, 3.f }, { EOp::Remove, A } } },
+	};
+
+	for (const FScenario& Scenario : Scenarios)
+	{
+		FRockGameplayTagFloatContainer Sequential;
+		FRockGameplayTagFloatContainer Batched;
+		ApplySequential(Sequential, Scenario.Setup);
+		ApplySequential(Batched, Scenario.Setup);
+
+		ApplySequential(Sequential, Scenario.Ops);
+		ApplyBatch(Batched, Scenario.Ops);
+
+		for (const FGameplayTag Tag : { A, B })
+		{
+			TestEqual(FString::Printf(TEXT("%s: %s contained"), Scenario.Name, *Tag.ToString()), Batched.ContainsTag(Tag), Sequential.ContainsTag(Tag));
+			TestEqual(FString::Printf(TEXT("%s: %s value"), Scenario.Name, *Tag.ToString()), Batched.GetFloatValue(Tag), Sequential.GetFloatValue(Tag));
+		}
+
+		const FGameplayTag Parent = TAG_Test_Parent;
+		TestEqual(FString::Printf(TEXT("%s: aggregate count"), Scenario.Name), Batched.GetAggregateCount(Parent), Sequential.GetAggregateCount(Parent));
+		TestEqual(FString::Printf(TEXT("%s: aggregate sum"), Scenario.Name), Batched.GetAggregateSum(Parent), Sequential.GetAggregateSum(Parent));
+		TestEqual(FString::Printf(TEXT("%s: aggregate max"), Scenario.Name), Batched.GetAggregateMax(Parent), Sequential.GetAggregateMax(Parent));
+	}
+
+	// Checked against the expected values too, not only against each other
+	{
+		FRockGameplayTagFloatContainer Container;
+		ApplyBatch(Container, { { EOp::Subtract, A, 2.f }, { EOp::Add, A, 1.f } });
+		TestEqual(TEXT("Subtract then add on a missing tag leaves the added value"), Container.GetFloatValue(A), 1.f);
+	}
+	{
+		FRockGameplayTagFloatContainer Container;
+		Container.SetFloat(A, 3.f);
+		ApplyBatch(Container, { { EOp::Subtract, A, 5.f }, { EOp::Add, A, 4.f } });
+		TestEqual(TEXT("Subtracting past zero removes the tag before adding"), Container.GetFloatValue(A), 4.f);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRockGameplayTagFloatAggregatesTest, "RockModularGameplayAbilities.TagFloatContainer.Aggregates",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRockGameplayTagFloatAggregatesTest::RunTest(const FString& Parameters)
+{
+	using namespace RockGameplayTagFloatContainerTests;
+
+	const FGameplayTag Parent = TAG_Test_Parent;
+	const FGameplayTag A = TAG_Test_A;
+	const FGameplayTag B = TAG_Test_B;
+
+	FRockGameplayTagFloatContainer Container;
+	Container.SetFloat(A, 2.f);
+	Container.SetFloat(B, 3.f);
+	Container.AddFloat(A, 1.f);
+
+	// Nothing queried the aggregates yet, so nothing is allocated for them
+	TestEqual(TEXT("Aggregate memory before the first query"), static_cast<uint64>(Container.GetAggregatesAllocatedSize()), static_cast<uint64>(0));
+	const SIZE_T SizeBeforeQuery = Container.GetAllocatedSize();
+
+	TestEqual(TEXT("Aggregate count"), Container.GetAggregateCount(Parent), 2);
+	const SIZE_T AggregatesSize = Container.GetAggregatesAllocatedSize();
+	TestTrue(TEXT("Aggregates are built by the first query"), AggregatesSize > 0);
+	TestEqual(TEXT("Only the aggregates grow with the first query"), static_cast<uint64>(Container.GetAllocatedSize()), static_cast<uint64>(SizeBeforeQuery + AggregatesSize));
+
+	TestEqual(TEXT("Aggregate sum"), Container.GetAggregateSum(Parent), 6.f);
+	TestEqual(TEXT("Aggregate product"), Container.GetAggregateProduct(Parent), 9.f);
+	TestEqual(TEXT("Aggregate max"), Container.GetAggregateMax(Parent), 3.f);
+
+	// Maintained from here on, a tiny float divides back out of the product without losing it
+	Container.SetFloat(A, 1e-30f);
+	Container.SetFloat(A, 4.f);
+	TestEqual(TEXT("Product after a tiny value"), Container.GetAggregateProduct(Parent), 12.f);
+
+	Container.SubtractFloat(B, 3.f);
+	TestEqual(TEXT("Product after removal"), Container.GetAggregateProduct(Parent), 4.f);
+	TestEqual(TEXT("Max after removal"), Container.GetAggregateMax(Parent), 4.f);
+	TestEqual(TEXT("Count after removal"), Container.GetAggregateCount(Parent), 1);
+	TestEqual(TEXT("Product of the removed tag"), Container.GetAggregateProduct(B), 1.f);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
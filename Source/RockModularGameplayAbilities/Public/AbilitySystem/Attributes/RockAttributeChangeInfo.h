@@ -7,9 +7,24 @@
 #include "GameplayEffectTypes.h"
 #include "GameplayTagContainer.h"
 
+#include <atomic>
+
 #include "RockAttributeChangeInfo.generated.h"
 
 class URockAbilitySystemComponent;
+struct FGameplayEffectSpec;
+
+/** How a change info gets the tags of the effect spec */
+enum class ERockAttributeChangeInfoTags : uint8
+{
+	/** Copy every tag container into the change info, it can be kept for as long as needed */
+	Copy,
+	/**
+	 * Reference the tag containers of the effect spec. Only valid during the modification callback, call MaterializeTags
+	 * before keeping the change info any longer. Read the tags through the Get*Tags accessors.
+	 */
+	View
+};
 
 /**
  * @brief Aggregates essential details extracted from a Gameplay Effect modification callback.
@@ -70,6 +85,7 @@ public:
 	
 	/**
 	* Gameplay tags associated with the source actor or effect.
+	* Empty while the change info views the spec tags (ERockAttributeChangeInfoTags::View), GetSourceTags works in both modes.
 	*/
 	UPROPERTY()
 	FGameplayTagContainer SourceTags;
@@ -77,12 +93,14 @@ public:
 	/**
 	* Asset tags extracted from the effect specification.
 	* These tags may be used to provide additional metadata or to drive effect-specific logic.
+	* Empty while the change info views the spec tags, GetSpecAssetTags works in both modes.
 	*/
 	UPROPERTY()
 	FGameplayTagContainer SpecAssetTags;
 
 	/**
 	 * Gameplay tags associated with the target actor or effect.
+	 * Empty while the change info views the spec tags, GetTargetTags works in both modes.
 	 */
 	UPROPERTY()
 	FGameplayTagContainer TargetTags;
@@ -99,4 +117,103 @@ public:
 	 */
 	UPROPERTY()
 	float DeltaMagnitude = 0.0f;
+
+	/** SourceTags, or the viewed tags of the spec */
+	const FGameplayTagContainer& GetSourceTags() const { return SourceTagsView ? *SourceTagsView : SourceTags; }
+
+	/** TargetTags, or the viewed tags of the spec */
+	const FGameplayTagContainer& GetTargetTags() const { return TargetTagsView ? *TargetTagsView : TargetTags; }
+
+	/** SpecAssetTags, or the asset tags of the viewed spec. Combining them requires a copy, so they're only built on first use */
+	const FGameplayTagContainer& GetSpecAssetTags() const;
+
+	/** Points the tags at the containers of the spec instead of copying them, see ERockAttributeChangeInfoTags::View */
+	void ViewSpecTags(const FGameplayEffectSpec& EffectSpec);
+
+	/** Copies every tag container this change info only references, so it can outlive the modification callback */
+	void MaterializeTags();
+
+	bool IsViewingSpecTags() const { return SourceTagsView || TargetTagsView || SpecAssetTagsSource; }
+
+	/** Clears every member, keeping the allocations of the tag containers for reuse */
+	void Reset();
+
+private:
+	const FGameplayTagContainer*	SourceTagsView = nullptr;
+	const FGameplayTagContainer*	TargetTagsView = nullptr;
+	const FGameplayEffectSpec*		SpecAssetTagsSource = nullptr;
+	// Asset tags of SpecAssetTagsSource, built on first access while viewing
+	mutable FGameplayTagContainer	ViewedSpecAssetTags;
+	mutable bool					bViewedSpecAssetTagsBuilt = false;
+};
+
+class FRockAttributeChangeInfoHandle;
+
+/**
+ * Recycles FRockAttributeChangeInfo instances, so the tag containers of a change info keep their allocations across modifications.
+ *
+ * Infos are handed out as FRockAttributeChangeInfoHandle, whose reference count lives next to the info in its pool entry, so neither
+ * allocating nor sharing an info allocates once the pool is warm. An info returns to the pool, and is reset, when its last handle
+ * is released. Never hold on to a raw pointer or reference to an info, or to one of its members, without also holding a handle to it.
+ * Infos may be released on any thread.
+ */
+class ROCKMODULARGAMEPLAYABILITIES_API FRockAttributeChangeInfoPool : public TSharedFromThis<FRockAttributeChangeInfoPool, ESPMode::ThreadSafe>
+{
+public:
+	/** MaxPooledInfos limits how many released infos are kept, any infos released beyond that are freed */
+	explicit FRockAttributeChangeInfoPool(int32 InMaxPooledInfos);
+	~FRockAttributeChangeInfoPool();
+
+	FRockAttributeChangeInfoHandle Alloc();
+
+private:
+	friend class FRockAttributeChangeInfoHandle;
+
+	struct FEntry
+	{
+		FRockAttributeChangeInfo	Info;
+		std::atomic<int32>			NumRefs = 0;
+		// Set while the info is in use, keeps the pool alive until the info returns to it
+		TSharedPtr<FRockAttributeChangeInfoPool, ESPMode::ThreadSafe> Pool;
+	};
+
+	/** Called when the last handle to the entry is released */
+	static void Release(FEntry* Entry);
+
+	FCriticalSection	FreeEntriesLock;
+	TArray<FEntry*>		FreeEntries;
+	int32				MaxPooledInfos = 0;
+};
+
+/** Shared ownership of a pooled FRockAttributeChangeInfo, see FRockAttributeChangeInfoPool */
+class ROCKMODULARGAMEPLAYABILITIES_API FRockAttributeChangeInfoHandle
+{
+public:
+	FRockAttributeChangeInfoHandle() = default;
+	FRockAttributeChangeInfoHandle(const FRockAttributeChangeInfoHandle& Other);
+	FRockAttributeChangeInfoHandle(FRockAttributeChangeInfoHandle&& Other);
+	~FRockAttributeChangeInfoHandle();
+
+	FRockAttributeChangeInfoHandle& operator=(const FRockAttributeChangeInfoHandle& Other);
+	FRockAttributeChangeInfoHandle& operator=(FRockAttributeChangeInfoHandle&& Other);
+
+	bool IsValid() const { return Entry != nullptr; }
+
+	/** Releases this handle's reference, the info returns to its pool if it was the last one */
+	void Reset();
+
+	FRockAttributeChangeInfo* Get() const { return Entry ? &Entry->Info : nullptr; }
+	FRockAttributeChangeInfo* operator->() const { check(Entry); return &Entry->Info; }
+	FRockAttributeChangeInfo& operator*() const { check(Entry); return Entry->Info; }
+
+private:
+	friend class FRockAttributeChangeInfoPool;
+
+	/** Adopts the reference the pool added to the entry */
+	explicit FRockAttributeChangeInfoHandle(FRockAttributeChangeInfoPool::FEntry* InEntry)
+		: Entry(InEntry)
+	{
+	}
+
+	FRockAttributeChangeInfoPool::FEntry* Entry = nullptr;
 };
\ No newline at end of file
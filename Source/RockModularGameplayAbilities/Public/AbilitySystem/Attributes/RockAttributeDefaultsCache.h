@@ -0,0 +1,77 @@
+// Copyright Broken Rock Studios LLC. All Rights Reserved.
+// See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** Directory entry of the defaults of one attribute set class within one group */
+struct FRockAttributeDefaultsCacheTable
+{
+	int32			SetIndex = INDEX_NONE;
+	int32			NumSamples = 0;
+	int32			NumRows = 0;
+	// Row of this table's values for every sample, consecutive samples with identical defaults share a row
+	TArray<int32>	RowBySample;
+	TArray<FName>	AttributeNames;
+	TArray<int32>	AttributeNumSamples;
+	// Offset of the first value of this table in the value block, in floats
+	int64			ValueOffset = 0;
+
+	/** True if there is a row for every sample and every row index is in range */
+	bool HasValidRows() const;
+
+	friend FArchive& operator<<(FArchive& Ar, FRockAttributeDefaultsCacheTable& Table);
+};
+
+/** Directory entry of one attribute defaults group */
+struct FRockAttributeDefaultsCacheGroup
+{
+	FName									GroupName;
+	int32									NumSamples = 0;
+	TArray<FRockAttributeDefaultsCacheTable>	Tables;
+
+	friend FArchive& operator<<(FArchive& Ar, FRockAttributeDefaultsCacheGroup& Group);
+};
+
+/**
+ * Compact, versioned binary image of the preloaded attribute defaults.
+ *
+ * The file holds a small directory (groups, attribute set class paths and attribute names) followed by a single block
+ * of values in the same shared row layout the initter uses. Loading memory maps the file and only deserializes the
+ * directory, the values are used in place. Class paths and attribute names are resolved by the initter on first use.
+ * The file is written for the machine that reads it and is not meant to be shipped between platforms.
+ */
+class ROCKMODULARGAMEPLAYABILITIES_API FRockAttributeDefaultsCache
+{
+public:
+	FRockAttributeDefaultsCache();
+	~FRockAttributeDefaultsCache();
+
+	/** Writes the directory and values to Filename, replacing any previous cache */
+	static bool Save(const FString& Filename, uint64 SourceStamp, int32 SamplesPerLevel, const TArray<FString>& SetClassPaths, const TArray<FRockAttributeDefaultsCacheGroup>& Groups, TConstArrayView<float> Values);
+
+	/** Maps Filename and reads its directory. Fails if the file is missing, corrupt, or was built from other sources or settings */
+	bool Load(const FString& Filename, uint64 SourceStamp, int32 SamplesPerLevel);
+
+	TConstArrayView<float> GetValues(int64 ValueOffset, int64 NumValues) const;
+
+	TArray<FString>							SetClassPaths;
+	TArray<FRockAttributeDefaultsCacheGroup>	Groups;
+
+private:
+	static constexpr uint32 Magic = 0x52414443; // RADC
+	static constexpr uint32 Version = 3;
+	static constexpr int64 ValueAlignment = 16;
+
+	TUniquePtr<IMappedFileHandle>	MappedFile;
+	TUniquePtr<IMappedFileRegion>	MappedRegion;
+	// Only used on platforms that can't memory map the file
+	TArray64<uint8>					LoadedBytes;
+
+	const float*					Values = nullptr;
+	int64							NumValues = 0;
+};
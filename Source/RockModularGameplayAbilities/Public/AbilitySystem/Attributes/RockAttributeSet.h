@@ -6,10 +6,10 @@
 
 #include "AttributeSet.h"
 #include "GameplayEffect.h"
+#include "AbilitySystem/Attributes/RockAttributeChangeInfo.h"
 
 #include "RockAttributeSet.generated.h"
 
-struct FRockAttributeChangeInfo;
 struct FGameplayEffectModCallbackData;
 struct FGameplayAttribute;
 class URockAbilitySystemComponent;
@@ -43,6 +43,28 @@ GAMEPLAYATTRIBUTE_VALUE_INITTER(PropertyName)
 */
 DECLARE_MULTICAST_DELEGATE_SixParams(FRockAttributeEvent, AActor* /*EffectInstigator*/, AActor* /*EffectCauser*/, const FGameplayEffectSpec* /*EffectSpec*/, float /*EffectMagnitude*/, float /*OldValue*/, float /*NewValue*/);
 DECLARE_MULTICAST_DELEGATE(FRockSimpleAttributeEvent);
+
+/** Every change one attribute went through during a frame, see URockAttributeSet::OnCoalescedAttributeChanges */
+struct FRockCoalescedAttributeChange
+{
+	FGameplayAttribute					Attribute;
+	// Value before the first change of the frame
+	float								OldValue = 0.f;
+	// Value after the last change of the frame
+	float								NewValue = 0.f;
+	// Sum of the raw magnitudes of every change, before clamping
+	float								TotalMagnitude = 0.f;
+	int32								NumChanges = 0;
+	// Every distinct instigator of the changes, in the order they happened
+	TArray<TWeakObjectPtr<AActor>>		Instigators;
+};
+
+/**
+ * Delegate used to broadcast the attribute changes of a whole frame at once:
+ * @param AttributeSet		The set the attributes belong to
+ * @param Changes			One entry per attribute that changed
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FRockCoalescedAttributeEvent, URockAttributeSet* /*AttributeSet*/, const TArray<FRockCoalescedAttributeChange>& /*Changes*/);
 //DECLARE_MULTICAST_DELEGATE_ThreeParams(FRockSurvivalMaxAttributeEvent, AActor* /*EffectInstigator*/, AActor* /*EffectCauser*/, const FGameplayEffectSpec* /*EffectSpec*/);
 
 
@@ -68,13 +90,63 @@ public:
 	// ~ Begin UAttributeSet
 	virtual bool ShouldInitProperty(bool FirstInit, FProperty* PropertyToInit) const override;
 	// ~ End UAttributeSet Interface
+
+	// ~ Begin UObject
+	virtual void BeginDestroy() override;
+	/** Applies the replicated base values the owning ASC deferred, see URockAbilitySystemComponent::bDeferReplicatedAttributeChanges */
+	virtual void PostRepNotifies() override;
+	// ~ End UObject
+
+	/**
+	 * Broadcast once at the end of every frame in which attributes of this set changed, alongside the immediate events.
+	 * Listeners that only care about the end result (UI, threat, etc) should bind here instead of to the immediate events,
+	 * a burst of modifications then costs them a single update. Nothing is recorded while this isn't bound.
+	 */
+	FRockCoalescedAttributeEvent OnCoalescedAttributeChanges;
+
+	/** Broadcasts the changes recorded so far instead of waiting for the end of the frame */
+	void FlushCoalescedAttributeChanges();
 	
-	virtual TSharedRef<FRockAttributeChangeInfo> GetAttributeChangeInfoFromModData(const FGameplayEffectModCallbackData& Data) const;
+	/**
+	 * TagCapture chooses how the tags are captured. Listeners that only read the delta and instigator should use
+	 * ERockAttributeChangeInfoTags::View, which doesn't copy any tags unless they're asked for or MaterializeTags is called.
+	 */
+	virtual TSharedRef<FRockAttributeChangeInfo> GetAttributeChangeInfoFromModData(const FGameplayEffectModCallbackData& Data, ERockAttributeChangeInfoTags TagCapture = ERockAttributeChangeInfoTags::Copy) const;
+
+	/** Same as GetAttributeChangeInfoFromModData, with the info taken from the pool of URockAbilitySystemGlobals so it doesn't allocate once the pool is warm */
+	virtual FRockAttributeChangeInfoHandle GetPooledAttributeChangeInfoFromModData(const FGameplayEffectModCallbackData& Data, ERockAttributeChangeInfoTags TagCapture = ERockAttributeChangeInfoTags::Copy) const;
 
 	/*
-	 * Optional helper function
+	 * Optional helper function, keeps AffectedAttribute at the same percentage of MaxAttribute.
+	 * Same as RescaleAttributeForMaxChange, with the current values taken from the attribute data.
 	 */
 	void AdjustAttributeForMaxChange(const FGameplayAttributeData& AffectedAttribute, const FGameplayAttributeData& MaxAttribute, float NewMaxValue, const FGameplayAttribute& AffectedAttributeProperty) const;
+
+	/**
+	 * Rescales AffectedAttribute so it keeps its ratio to MaxAttribute once the max becomes NewMaxValue.
+	 * The new base value is set straight through the ASC rather than by applying an override mod, so no effect spec is
+	 * built, Pre/PostGameplayEffectExecute are not called and the attribute broadcasts a single change.
+	 * Both attributes are read through the owning ASC, so they may belong to any of its sets. Does nothing if one of them doesn't.
+	 * @param bRoundToWhole		Round the rescaled value to the nearest whole number, so 0.5 health never shows up
+	 */
+	void RescaleAttributeForMaxChange(const FGameplayAttribute& AffectedAttribute, const FGameplayAttribute& MaxAttribute, float NewMaxValue, bool bRoundToWhole = true) const;
+
+protected:
+	/** Fills every member of OutInfo from the modification callback, shared by the shared and pooled change infos */
+	void FillAttributeChangeInfoFromModData(const FGameplayEffectModCallbackData& Data, ERockAttributeChangeInfoTags TagCapture, FRockAttributeChangeInfo& OutInfo) const;
+
+	/** Broadcasts an immediate attribute event and records the change for OnCoalescedAttributeChanges */
+	void BroadcastAttributeEvent(const FRockAttributeEvent& Event, const FGameplayAttribute& Attribute, AActor* EffectInstigator, AActor* EffectCauser, const FGameplayEffectSpec* EffectSpec, float EffectMagnitude, float OldValue, float NewValue);
+
+	/** Records a change for OnCoalescedAttributeChanges, for sets that broadcast their immediate events themselves */
+	void RecordCoalescedAttributeChange(const FGameplayAttribute& Attribute, AActor* EffectInstigator, float EffectMagnitude, float OldValue, float NewValue);
+
+private:
+	/** Sets the base value of Attribute to keep its ratio of CurrentValue to CurrentMaxValue at NewMaxValue */
+	void RescaleAttributeBase(const FGameplayAttribute& Attribute, float CurrentValue, float CurrentMaxValue, float NewMaxValue, bool bRoundToWhole) const;
+
+	TArray<FRockCoalescedAttributeChange>	PendingCoalescedChanges;
+	FDelegateHandle							CoalescedChangesEndFrameHandle;
 };
 
 
@@ -87,6 +159,9 @@ public:
 	FName GetAttributeInitCategory() const;
 	FName GetAttributeInitSubCategory() const;
 	bool IsValid() const { return !AttributeInitCategory.IsNone() && !AttributeInitSubCategory.IsNone(); }
+
+	/** "Category.SubCategory", the name of the attribute defaults group. Builds a new name, use the cached group index at runtime */
+	FName GetAttributeInitGroupName() const;
 	
 protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
@@ -95,11 +170,27 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	FName AttributeInitSubCategory;
 
+	// Group index resolved by URockAbilitySystemGlobals on first use, valid while CachedGroupGeneration matches the current initter
+	mutable int32 CachedGroupIndex = INDEX_NONE;
+	mutable uint32 CachedGroupGeneration = 0;
+	// The group of this key doesn't exist and CachedGroupIndex is the "Default" group
+	mutable bool bCachedGroupIsFallback = false;
+
+	friend class URockAbilitySystemGlobals;
+
 #if WITH_EDITOR
 	friend class FRockAttributeInitKeyCustomization;
 #endif
 };
 
+/** A single ASC to initialize with URockAbilitySystemGlobals::InitAttributeSetDefaultsBatch */
+struct FRockAttributeInitializationRequest
+{
+	UAbilitySystemComponent*			AbilitySystemComponent = nullptr;
+	FRockAttributeInitializationKey		Key;
+	float								Level = 1.f;
+};
+
 //+GlobalAttributeSetDefaultsTableNames=/Game/AttributeTables/HeroAtributeData_Scaling.HeroAtributeData_Scaling
 //+GlobalAttributeSetDefaultsTableNames=/Game/AttributeTables/AttributesBuilding.AttributesBuilding
 //+GlobalAttributeSetDefaultsTableNames=/Game/AttributeTables/AIAttributeData_Scaling.AIAttributeData_Scaling
@@ -6,16 +6,56 @@
 
 #include "CoreMinimal.h"
 #include "AttributeSet.h"
+#include "UObject/ObjectKey.h"
+
+class FRockAttributeDefaultsCache;
+struct FRockAttributeDefaultsCacheGroup;
+
+namespace RockAttributeSetInitter
+{
+	struct FParsedAttributeRow;
+}
+
+/** Default of one attribute, see FRockAttributeSetInitter::GetAttributeSetDefaults */
+struct FRockAttributeDefaultValue
+{
+	FProperty*	Property = nullptr;
+	float		Value = 0.f;
+};
+
+/** A single ASC to initialize with FRockAttributeSetInitter::InitAttributeSetDefaultsBatch */
+struct FRockAttributeDefaultsInitRequest
+{
+	UAbilitySystemComponent*	AbilitySystemComponent = nullptr;
+	// Group index from FRockAttributeSetInitter::ResolveGroupIndex
+	int32						GroupIndex = INDEX_NONE;
+	float						Level = 1.f;
+};
 
 /**
- * 
+ * Attribute set initter that preloads the curve tables into flat lookup tables per group and attribute set.
+ *
+ * By default it relies on the existence and usage of discrete levels for data look-up: curve keys must be 1, 2, 3...
+ * In interpolated mode curves may use sparse or fractional keys. They are sampled (CurveTable->Eval) into the lookup
+ * tables at preload with SamplesPerLevel samples per level, and fractional levels interpolate between the samples,
+ * so no curve is evaluated at spawn time.
+ *
+ * The preloaded tables can be saved to and loaded from a FRockAttributeDefaultsCache. A loaded cache is used in place,
+ * its classes and attributes are resolved once while loading.
+ *
+ * With bWriteAttributesDirectly, ASCs without active gameplay effects or attribute aggregators (see URockAbilitySystemComponent::CanInitAttributesDirectly)
+ * get their defaults written straight into the attribute sets at precomputed offsets, base and current value alike, followed by one
+ * batch of value change notifications. This skips PreAttributeChange, PreAttributeBaseChange and PostAttributeBaseChange of the sets,
+ * so it's only suitable for sets that don't clamp or react to their initial values there.
  */
-/** Explicit implementation of attribute set initter, relying on the existence and usage of discrete levels for data look-up (that is, CurveTable->Eval is not possible) */
 // FAttributeSetInitterDiscreteLevels
 struct ROCKMODULARGAMEPLAYABILITIES_API  FRockAttributeSetInitter : public FAttributeSetInitter
 {
 
 public:
+	FRockAttributeSetInitter(bool bInInterpolateLevels = false, int32 InSamplesPerLevel = 1, bool bInWriteAttributesDirectly = false);
+	~FRockAttributeSetInitter();
+
 	// ~ Begin FAttributeSetInitter
 	virtual void PreloadAttributeSetData(const TArray<UCurveTable*>& CurveData) override;
 	virtual void InitAttributeSetDefaults(UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, int32 Level, bool bInitialInit) const override;
@@ -23,39 +63,229 @@ public:
 	virtual TArray<float> GetAttributeSetValues(UClass* AttributeSetClass, FProperty* AttributeProperty, FName GroupName) const override;
 	// ~ End FAttributeSetInitter Interface
 
+	/** Same as InitAttributeSetDefaults, for fractional levels. Values between two samples are linearly interpolated */
+	void InitAttributeSetDefaultsInterpolated(UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, float Level, bool bInitialInit) const;
+
+	/**
+	 * Resolves a group name to the dense index used by the *ForGroup functions, falling back to the "Default" group.
+	 * Indices stay valid until GetGeneration changes.
+	 */
+	int32 ResolveGroupIndex(FName GroupName, bool& bOutIsFallback) const;
+
+	/**
+	 * Changes whenever the groups are rebuilt.
+	 * Generations are unique across the process, so they never repeat when the initter is reallocated.
+	 */
+	uint32 GetGeneration() const { return Generation; }
+
+	FName GetGroupName(int32 GroupIndex) const { return Groups.IsValidIndex(GroupIndex) ? Groups[GroupIndex].GroupName : NAME_None; }
+
+	void InitAttributeSetDefaultsForGroup(UAbilitySystemComponent* AbilitySystemComponent, int32 GroupIndex, float Level, bool bInitialInit) const;
+
+	/**
+	 * Re-initializes the defaults for a level change, like InitAttributeSetDefaults(ToLevel) without bInitialInit,
+	 * but only writes the attributes whose default differs between the two levels.
+	 */
+	void ApplyLevelTransition(UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, int32 FromLevel, int32 ToLevel) const;
+	void ApplyLevelTransitionForGroup(UAbilitySystemComponent* AbilitySystemComponent, int32 GroupIndex, int32 FromLevel, int32 ToLevel) const;
+
+	/** Initializes many ASCs at once on the calling thread, reusing one buffer for the gathered values of every request */
+	void InitAttributeSetDefaultsBatch(TConstArrayView<FRockAttributeDefaultsInitRequest> Requests, bool bInitialInit) const;
+	void ApplyAttributeDefaultForGroup(UAbilitySystemComponent* AbilitySystemComponent, const FGameplayAttribute& InAttribute, int32 GroupIndex, int32 Level) const;
+	TArray<float> GetAttributeSetValuesForGroup(UClass* AttributeSetClass, FProperty* AttributeProperty, int32 GroupIndex) const;
+
+	/**
+	 * Same as GetAttributeSetValues without copying: a view of the attribute's per level defaults, stored when the group was built.
+	 * Valid until the defaults are rebuilt (see GetGeneration).
+	 */
+	TConstArrayView<float> GetAttributeSetValuesView(const UClass* AttributeSetClass, const FProperty* AttributeProperty, FName GroupName) const;
+	TConstArrayView<float> GetAttributeSetValuesViewForGroup(const UClass* AttributeSetClass, const FProperty* AttributeProperty, int32 GroupIndex) const;
+
+	/**
+	 * Gathers the default of every attribute the group defines for SetClass (or its closest parent class with defaults) at Level.
+	 * Doesn't consult ShouldInitProperty. Returns false if the group, the class or the level has no defaults.
+	 */
+	bool GetAttributeSetDefaults(FName GroupName, const UClass* SetClass, float Level, TArray<FRockAttributeDefaultValue>& OutDefaults) const;
+
+	/** Writes the preloaded defaults to a cache file. SourceStamp identifies the curve tables and settings they were built from */
+	bool SaveDefaultsCache(const FString& Filename, uint64 SourceStamp) const;
+
+	/**
+	 * Uses a cache file written by SaveDefaultsCache instead of preloading the curve tables. Every group is resolved right away,
+	 * if any turns out to be stale (a class or attribute no longer exists) the cache is dropped and this returns false.
+	 */
+	bool LoadDefaultsCache(const FString& Filename, uint64 SourceStamp);
+
+	/**
+	 * Rebuilds only the groups fed by ChangedTables, before or after the change, leaving every other group untouched.
+	 * CurveData is the full list of default tables, in the same order as passed to PreloadAttributeSetData.
+	 */
+	void ReloadCurveTables(const TArray<UCurveTable*>& CurveData, const TArray<UCurveTable*>& ChangedTables, TArray<FName>& OutReloadedGroups);
+
 private:
 	bool IsSupportedProperty(FProperty* Property) const;
 
-	
-	struct FAttributeDefaultValueList
+	struct FAttributeSetDefaultsTable;
+
+	struct FPendingAttributeBaseValue
 	{
-		void AddPair(FProperty* InProperty, float InValue)
+		UAttributeSet*						Set;
+		const FAttributeSetDefaultsTable*	Table;
+		int32								AttributeIndex;
+		float								Value;
+	};
+
+	using FPendingAttributeBaseValues = TArray<FPendingAttributeBaseValue, TInlineAllocator<64>>;
+
+	/**
+	 * Writes all gathered base values in one pass.
+	 * Aggregator re-evaluation is batched until every base value is written, and replication is flushed once.
+	 */
+	void WriteAttributeBaseValues(UAbilitySystemComponent* AbilitySystemComponent, TConstArrayView<FPendingAttributeBaseValue> BaseValues) const;
+
+	/** Bumps Generation to a value no initter has used yet */
+	void AdvanceGeneration();
+
+	/** Writes base and current values straight into the sets, for ASCs without aggregators. Change delegates are broadcast after all writes */
+	static void WriteAttributeValuesDirectly(UAbilitySystemComponent* AbilitySystemComponent, TConstArrayView<FPendingAttributeBaseValue> BaseValues);
+
+	/** Adds the defaults of every attribute of the table the set wants initialized */
+	static void GatherAttributeBaseValues(UAttributeSet* Set, const FAttributeSetDefaultsTable& Table, int32 SampleIndex, float Alpha, bool bInitialInit, FPendingAttributeBaseValues& OutBaseValues);
+
+	/**
+	 * Defaults of a single attribute set class within a single group.
+	 * Values are stored sample-major, so all defaults of one sample are a contiguous row of Attributes.Num() floats.
+	 * Consecutive samples with identical defaults share a row. In discrete mode there is exactly one sample per level.
+	 * Values either point into ValueStorage or, when loaded from a cache, into the mapped cache file.
+	 */
+	struct FAttributeSetDefaultsTable
+	{
+		const float* GetSampleValues(int32 SampleIndex) const
 		{
-			List.Add(FOffsetValuePair(InProperty, InValue));
+			return Values.GetData() + RowBySample[SampleIndex] * Attributes.Num();
 		}
 
-		struct FOffsetValuePair
+		bool HasValue(int32 AttributeIndex, int32 SampleIndex) const
 		{
-			FOffsetValuePair(FProperty* InProperty, float InValue)
-			: Property(InProperty), Value(InValue) { }
+			return SampleIndex < AttributeNumSamples[AttributeIndex];
+		}
 
-			FProperty*	Property;
-			float		Value;
-		};
+		int32 FindAttributeIndex(const FProperty* Property) const
+		{
+			const int32* AttributeIndex = AttributeIndexByProperty.Find(Property);
+			return AttributeIndex ? *AttributeIndex : INDEX_NONE;
+		}
 
-		TArray<FOffsetValuePair>	List;
-	};
+		/** The values of the attribute at every whole level */
+		TConstArrayView<float> GetLevelColumn(int32 AttributeIndex) const
+		{
+			if (!Attributes.IsValidIndex(AttributeIndex))
+			{
+				return TConstArrayView<float>();
+			}
+			return TConstArrayView<float>(LevelColumns.GetData() + LevelColumnOffsets[AttributeIndex], LevelColumnOffsets[AttributeIndex + 1] - LevelColumnOffsets[AttributeIndex]);
+		}
 
-	struct FAttributeSetDefaults
-	{
-		TMap<TSubclassOf<UAttributeSet>, FAttributeDefaultValueList> DataMap;
+		/** Collapses runs of identical sample rows in ValueStorage, which has to hold one row per sample */
+		void ShareSampleRows();
+
+		/** Builds the property lookup and the per level columns once the values are in place */
+		void BuildLookups(int32 InSamplesPerLevel);
+
+		/** Value of the attribute at the sample, blended towards the next sample by Alpha if the attribute defines one */
+		float GetValue(int32 AttributeIndex, int32 SampleIndex, float Alpha) const
+		{
+			const float Value = GetSampleValues(SampleIndex)[AttributeIndex];
+			if (Alpha > 0.f && HasValue(AttributeIndex, SampleIndex + 1))
+			{
+				return FMath::Lerp(Value, GetSampleValues(SampleIndex + 1)[AttributeIndex], Alpha);
+			}
+			return Value;
+		}
+
+		TSubclassOf<UAttributeSet>	SetClass;
+		TArray<FProperty*>			Attributes;
+		// Number of samples defined by the curve of each attribute, attributes have no default past their last sample
+		TArray<int32>				AttributeNumSamples;
+		int32						NumSamples = 0;
+		TConstArrayView<float>		Values;
+		TArray<float>				ValueStorage;
+		// Row of Values holding the defaults of every sample
+		TArray<int32>				RowBySample;
+
+		TMap<const FProperty*, int32>	AttributeIndexByProperty;
+		// Per attribute: the attribute to write through the ASC, and the offset in the set (and numeric property, if not FGameplayAttributeData) to write directly
+		TArray<FGameplayAttribute>		GameplayAttributes;
+		TArray<int32>					AttributeOffsets;
+		TArray<const FNumericProperty*>	NumericProperties;
+		// Attribute-major copy of the whole level samples, the column of an attribute spans LevelColumnOffsets[i] to [i + 1]
+		TArray<int32>					LevelColumnOffsets;
+		TArray<float>					LevelColumns;
+
+		// Attributes whose default is new or different from the previous sample, the ones of sample i span ChangedAttributeOffsets[i] to [i + 1]
+		TArray<int32>					ChangedAttributeOffsets;
+		TArray<int32>					ChangedAttributes;
 	};
 
-	struct FAttributeSetDefaultsCollection
+	struct FAttributeSetDefaultsGroup
 	{
-		TArray<FAttributeSetDefaults>		LevelData;
+		FName			GroupName;
+		int32			NumSamples = 0;
+		// Index into Tables for every dense set class index, INDEX_NONE if this group has no defaults for that class
+		TArray<int32>	TableIndexBySet;
+		// Concrete set class to the table of the closest class in its hierarchy with defaults, filled lazily on first use
+		mutable TMap<TObjectKey<UClass>, int32> ResolvedTableByClass;
+		// Curve tables with rows for this group. Only compared, never dereferenced
+		TArray<const UCurveTable*> SourceTables;
 	};
 
-	TMap<FName, FAttributeSetDefaultsCollection>	Defaults;
+	/**
+	 * Resolves every curve row to its group name, attribute set class and attribute, and samples its curve.
+	 * Row name splitting, property lookup and curve sampling run in parallel, rows keep their table order.
+	 */
+	void ParseCurveTables(const TArray<UCurveTable*>& CurveData, TArray<RockAttributeSetInitter::FParsedAttributeRow>& OutParsedRows) const;
+
+	/** Builds the tables of every group with parsed rows, replacing their previous tables. Groups without rows are kept */
+	void BuildGroupTables(TArray<RockAttributeSetInitter::FParsedAttributeRow>& ParsedRows);
+
+	/** Removes tables no group references anymore and remaps the table indices of every group */
+	void CompactTables();
+
+	/** Reports the value and lookup memory of the tables and groups, lazily resolved class tables are counted as of the last rebuild */
+	void UpdateMemoryStats() const;
+
+	/** Converts a curve into one value per sample. Returns false (and logs) if the curve can't be used */
+	bool SampleCurve(const FRealCurve* Curve, FName RowName, TArray<float>& OutSamples) const;
+
+	/** Converts a level to the sample at or below it and the blend towards the next sample. Returns false if the group doesn't define the level */
+	bool FindSamplePosition(const FAttributeSetDefaultsGroup& Group, float Level, int32& OutSampleIndex, float& OutAlpha) const;
+
+	/** Returns the dense index of the group, or of the "Default" group if it doesn't exist. INDEX_NONE if neither exists */
+	int32 FindGroupIndexWithFallback(FName GroupName) const;
+
+	/** Returns the dense index of the group, INDEX_NONE if it doesn't exist */
+	int32 FindResolvedGroupIndex(FName GroupName) const;
+
+	/** Resolves the classes and attributes of a group loaded from the cache and points its tables at the mapped values */
+	bool ResolveCachedGroup(int32 GroupIndex, const FRockAttributeDefaultsCacheGroup& CacheGroup);
+
+	/** Returns the defaults table for the set class (or the closest parent class with defaults) in the group. Resolved once per class */
+	const FAttributeSetDefaultsTable* FindDefaultsTable(const FAttributeSetDefaultsGroup& Group, const UClass* SetClass) const;
+
+	const FAttributeSetDefaultsTable* FindExactDefaultsTable(const FAttributeSetDefaultsGroup& Group, const UClass* SetClass) const;
+
+	TMap<FName, int32>							GroupIndexByName;
+	TArray<FAttributeSetDefaultsGroup>			Groups;
+	TMap<const UClass*, int32>					SetIndexByClass;
+	TArray<TSubclassOf<UAttributeSet>>			SetClasses;
+	TArray<FAttributeSetDefaultsTable>			Tables;
+
+	TUniquePtr<FRockAttributeDefaultsCache>		DefaultsCache;
+
+	uint32										Generation = 0;
+
+	bool										bInterpolateLevels = false;
+	bool										bWriteAttributesDirectly = false;
+	int32										SamplesPerLevel = 1;
 };
 
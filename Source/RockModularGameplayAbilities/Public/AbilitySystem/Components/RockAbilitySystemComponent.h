@@ -60,6 +60,9 @@ public:
 	void CancelActivationGroupAbilities(ERockAbilityActivationGroup Group, URockGameplayAbility* IgnoreRockAbility, bool bReplicateCancelAbility);
 	void DeferredSetBaseAttributeValueFromReplication(const FGameplayAttribute& attribute, const FGameplayAttributeData& newValue);
 	void DeferredSetBaseAttributeValueFromReplication(const FGameplayAttribute& attribute, float newValue);
+
+	/** Applies the replicated base values queued by DeferredSetBaseAttributeValueFromReplication and broadcasts their changes */
+	void FlushReplicatedAttributeChanges();
 	
 	/** Gets the ability target data associated with the given ability handle and activation info */
 	void GetAbilityTargetData(const FGameplayAbilitySpecHandle AbilityHandle, FGameplayAbilityActivationInfo ActivationInfo, FGameplayAbilityTargetDataHandle& OutTargetDataHandle);
@@ -70,6 +73,15 @@ public:
 	/** Looks at ability tags and gathers additional required and blocking tags */
 	void GetAdditionalActivationTagRequirements(const FGameplayTagContainer& AbilityTags, FGameplayTagContainer& OutActivationRequired, FGameplayTagContainer& OutActivationBlocked) const;
 
+	/**
+	 * True while no gameplay effect is active on this ASC, locally applied or replicated.
+	 * Attribute defaults can then be written straight into the sets, for attributes without an aggregator (see HasAttributeAggregator).
+	 */
+	bool CanInitAttributesDirectly() const { return ActiveGameplayEffects.GetNumGameplayEffects() == 0; }
+
+	/** True if the attribute has an aggregator, created by an effect modifying it or by capturing it for an effect */
+	bool HasAttributeAggregator(const FGameplayAttribute& Attribute) const { return ActiveGameplayEffects.FindAttributeAggregator(Attribute).Get() != nullptr; }
+
 	
 protected:
 
@@ -108,4 +120,26 @@ protected:
 
 	// Number of abilities running in each activation group.
 	int32 ActivationGroupCounts[static_cast<uint8>(ERockAbilityActivationGroup::MAX)];
+
+	/**
+	 * Queue the replicated base values of URockAttributeSet attributes and apply them together from the set's PostRepNotifies,
+	 * once every property of the set in the net update has been received. Listeners then never see Health updated against
+	 * a stale MaxHealth of the same set, and the changes are broadcast within the same net update.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Attributes")
+	bool bDeferReplicatedAttributeChanges = false;
+
+private:
+	struct FPendingReplicatedAttributeChange
+	{
+		FGameplayAttribute	Attribute;
+		float				OldBaseValue = 0.f;
+		float				NewBaseValue = 0.f;
+	};
+
+	void QueueReplicatedBaseAttributeValue(const FGameplayAttribute& Attribute, float NewBaseValue);
+	void ApplyReplicatedBaseAttributeValue(const FGameplayAttribute& Attribute, float NewBaseValue, float OldBaseValue);
+
+	// Replicated base values waiting for FlushReplicatedAttributeChanges, one per attribute
+	TArray<FPendingReplicatedAttributeChange> PendingReplicatedAttributeChanges;
 };
@@ -3,12 +3,49 @@
 #pragma once
 
 #include "GameplayTagContainer.h"
+#include "Algo/BinarySearch.h"
 #include "Net/Serialization/FastArraySerializer.h"
 
 #include "RockGameplayTagFloatContainer.generated.h"
 
 struct FRockGameplayTagFloatContainer;
+struct FRockGameplayTagFloatBatchEdit;
 struct FNetDeltaSerializeInfo;
+class UPackageMap;
+
+namespace UE::Net
+{
+	struct FRockGameplayTagFloatNetSerializer;
+}
+
+/**
+ * Fixed-point encoding of replicated tag float values. Only the wire format is quantized, the authority keeps exact values.
+ * Values outside of [MinValue, MaxValue] are clamped on the receiving side. Configured for all containers on
+ * URockAbilitySystemGlobals, so the server and clients always agree on it.
+ */
+USTRUCT(BlueprintType)
+struct ROCKMODULARGAMEPLAYABILITIES_API FRockTagFloatQuantization
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quantization")
+	float MinValue = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quantization")
+	float MaxValue = 4.f;
+
+	// Bits used to replicate a value, 0 replicates the full float
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quantization", meta = (ClampMin = 0, ClampMax = 24))
+	int32 NumBits = 0;
+
+	bool IsEnabled() const { return NumBits > 0 && NumBits <= 24 && MaxValue > MinValue; }
+
+	uint32 Quantize(float Value) const;
+	float Dequantize(uint32 QuantizedValue) const;
+
+	// Difference between two neighboring encoded values
+	float GetStepSize() const { return (MaxValue - MinValue) / static_cast<float>((1u << NumBits) - 1); }
+};
 
 /**
  * Represents one float of a gameplay tag (tag + count)
@@ -29,14 +66,124 @@ struct FRockGameplayTagFloat : public FFastArraySerializerItem
 
 	FString GetDebugString() const;
 
+	/** Replicates the value with the quantization of its tag. Iris uses FRockGameplayTagFloatNetSerializer */
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	/** The quantization used to replicate values of Tag, see URockAbilitySystemGlobals::GetTagFloatNetQuantization */
+	static const FRockTagFloatQuantization& GetNetQuantization(FGameplayTag Tag);
+
+	/** Stacks only ever hold positive values, so a received value that quantized to 0 or below is raised to one step */
+	static float DequantizeValue(const FRockTagFloatQuantization& Quantization, uint32 QuantizedValue)
+	{
+		return FMath::Max(Quantization.Dequantize(QuantizedValue), Quantization.GetStepSize());
+	}
+
 private:
 	friend FRockGameplayTagFloatContainer;
+	friend UE::Net::FRockGameplayTagFloatNetSerializer;
 
 	UPROPERTY()
 	FGameplayTag Tag;
 
 	UPROPERTY()
 	float FloatValue = 0;
+
+	// Value last folded into the parent aggregates of the container, 0 while not aggregated
+	mutable float AggregatedValue = 0;
+};
+
+template<>
+struct TStructOpsTypeTraits<FRockGameplayTagFloat> : public TStructOpsTypeTraitsBase2<FRockGameplayTagFloat>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** Aggregate of every float under one tag (the tag itself and all of its children) */
+struct FRockGameplayTagFloatAggregate
+{
+	float	Sum = 0.f;
+	float	Max = 0.f;
+	int32	Count = 0;
+	// Product as ProductMantissa * 2^ProductExponent, so floats can be divided back out without underflowing or overflowing
+	double	ProductMantissa = 1.0;
+	int32	ProductExponent = 0;
+
+	float GetProduct() const;
+
+	/** Multiplies the product by Factor, which has to be positive and finite. Returns false if the product degenerated */
+	bool ScaleProduct(double Factor);
+};
+
+/**
+ * Tag to stack index lookup of FRockGameplayTagFloatContainer. Most containers only hold a handful of tags, those are kept
+ * in a sorted array stored inline in the container. Past InlineCapacity tags it switches to a hash map until it's reset.
+ */
+struct FRockGameplayTagIndexMap
+{
+	static constexpr int32 InlineCapacity = 6;
+
+	const int32* Find(FGameplayTag Tag) const
+	{
+		if (bHashed)
+		{
+			return HashedEntries.Find(Tag);
+		}
+		const int32 EntryIndex = FindSortedEntry(Tag);
+		return EntryIndex != INDEX_NONE ? &SortedEntries[EntryIndex].Index : nullptr;
+	}
+
+	int32* Find(FGameplayTag Tag)
+	{
+		return const_cast<int32*>(static_cast<const FRockGameplayTagIndexMap*>(this)->Find(Tag));
+	}
+
+	bool Contains(FGameplayTag Tag) const
+	{
+		return Find(Tag) != nullptr;
+	}
+
+	int32& operator[](FGameplayTag Tag)
+	{
+		int32* Index = Find(Tag);
+		check(Index);
+		return *Index;
+	}
+
+	// Adds Tag, or replaces its index if it's already present
+	void Add(FGameplayTag Tag, int32 Index);
+	void Remove(FGameplayTag Tag);
+	void Reset();
+
+	// Heap memory of the lookup, 0 while the tags fit inline
+	SIZE_T GetAllocatedSize() const
+	{
+		return SortedEntries.GetAllocatedSize() + HashedEntries.GetAllocatedSize();
+	}
+
+private:
+	struct FEntry
+	{
+		FGameplayTag	Tag;
+		int32			Index = INDEX_NONE;
+	};
+
+	static FName GetEntryName(const FEntry& Entry)
+	{
+		return Entry.Tag.GetTagName();
+	}
+
+	int32 FindSortedEntry(FGameplayTag Tag) const
+	{
+		// Sorted by name index rather than lexically, the order only has to be stable within a run
+		return Algo::BinarySearchBy(SortedEntries, Tag.GetTagName(), &GetEntryName, FNameFastLess());
+	}
+
+	TArray<FEntry, TInlineAllocator<InlineCapacity>> SortedEntries;
+	TMap<FGameplayTag, int32> HashedEntries;
+	bool bHashed = false;
 };
 
 /** Container of gameplay tag stacks */
@@ -67,33 +214,147 @@ public:
 	// Returns the stack count of the specified tag (or 0 if the tag is not present)
 	float GetFloatValue(FGameplayTag Tag) const
 	{
-		return TagToFloatMap.FindRef(Tag);
+		const int32* StackIndex = TagToIndexMap.Find(Tag);
+		return StackIndex ? Stacks[*StackIndex].FloatValue : 0.f;
 	}
 
 	// Returns true if there is at least one stack of the specified tag
 	bool ContainsTag(FGameplayTag Tag) const
 	{
-		return TagToFloatMap.Contains(Tag);
+		return TagToIndexMap.Contains(Tag);
+	}
+
+	// Heap memory of the stacks, the tag lookup and the aggregates. Until aggregates are queried, containers with
+	// up to FRockGameplayTagIndexMap::InlineCapacity tags have a single allocation, the stacks
+	SIZE_T GetAllocatedSize() const
+	{
+		return Stacks.GetAllocatedSize() + TagToIndexMap.GetAllocatedSize() + ParentAggregates.GetAllocatedSize();
+	}
+
+	// Heap memory of the aggregates alone, 0 until the first aggregate query
+	SIZE_T GetAggregatesAllocatedSize() const
+	{
+		return ParentAggregates.GetAllocatedSize();
+	}
+
+	/**
+	 * The aggregates are only built by the first of these queries, and only maintained on every change from then on.
+	 * Containers that never query them don't pay for them.
+	 */
+
+	// Returns the sum of the floats of ParentTag and all of its children (or 0 if there are none)
+	float GetAggregateSum(FGameplayTag ParentTag) const
+	{
+		const FRockGameplayTagFloatAggregate* Aggregate = FindAggregate(ParentTag);
+		return Aggregate ? Aggregate->Sum : 0.f;
+	}
+
+	// Returns the product of the floats of ParentTag and all of its children (or 1 if there are none)
+	float GetAggregateProduct(FGameplayTag ParentTag) const;
+
+	// Returns the largest float of ParentTag and all of its children (or 0 if there are none)
+	float GetAggregateMax(FGameplayTag ParentTag) const
+	{
+		const FRockGameplayTagFloatAggregate* Aggregate = FindAggregate(ParentTag);
+		return Aggregate ? Aggregate->Max : 0.f;
+	}
+
+	// Returns the number of tags under ParentTag, including ParentTag itself
+	int32 GetAggregateCount(FGameplayTag ParentTag) const
+	{
+		const FRockGameplayTagFloatAggregate* Aggregate = FindAggregate(ParentTag);
+		return Aggregate ? Aggregate->Count : 0;
 	}
 
 	//~FFastArraySerializer contract
 	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize);
 	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
 	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize);
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
 	//~End of FFastArraySerializer contract
 
-	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
-	{
-		return FFastArraySerializer::FastArrayDeltaSerialize<FRockGameplayTagFloat, FRockGameplayTagFloatContainer>(Stacks, DeltaParms, *this);
-	}
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
 
 private:
+	friend FRockGameplayTagFloatBatchEdit;
+
+	// Removes the stack at StackIndex by swapping the last stack into its place
+	void RemoveStackAt(int32 StackIndex);
+	void RebuildTagToIndexMap();
+
+	// Returns the aggregate of ParentTag, building the aggregates of every stack first if nothing queried them yet
+	FRockGameplayTagFloatAggregate* FindAggregate(FGameplayTag ParentTag) const;
+	void BuildAggregates() const;
+
+	// Folds the change of Stack from its aggregated value to NewValue into the aggregates of the tag and all of its parents
+	void UpdateAggregates(const FRockGameplayTagFloat& Stack, float NewValue) const;
+	float FindAggregateMax(FGameplayTag ParentTag) const;
+	void RecomputeAggregateProduct(FGameplayTag ParentTag, FRockGameplayTagFloatAggregate& Aggregate) const;
+
 	// Replicated list of gameplay tag stacks
 	UPROPERTY()
 	TArray<FRockGameplayTagFloat> Stacks;
-	
-	// Accelerated list of tag stacks for queries
-	TMap<FGameplayTag, float> TagToFloatMap;
+
+	// Index of each tag's stack in Stacks, for fast queries and mutations without a heap allocation for small containers
+	FRockGameplayTagIndexMap TagToIndexMap;
+
+	// Aggregates of every tag that has at least one matching stack, maintained on every change once bAggregatesBuilt
+	mutable TMap<FGameplayTag, FRockGameplayTagFloatAggregate> ParentAggregates;
+	mutable bool bAggregatesBuilt = false;
+
+	// Set when replication removed stacks, the fast array swaps items around after PreReplicatedRemove
+	bool bTagToIndexMapStale = false;
+};
+
+/**
+ * Collects changes to many tags of a container and applies them in one pass when committed (or destroyed).
+ * Changes to the same tag are merged first, so every tag is dirtied at most once and removals only dirty the array once.
+ * The result is the same as calling the matching container functions one after another. Each tag's value is read from the
+ * container when the batch first touches it, the container must not be changed otherwise until the batch is committed.
+ *
+ *	FRockGameplayTagFloatBatchEdit Batch(Container);
+ *	Batch.AddFloat(TAG_Stance_Speed, 0.2f);
+ *	Batch.RemoveTag(TAG_Stance_Sprint);
+ *	Batch.Commit();
+ */
+struct ROCKMODULARGAMEPLAYABILITIES_API FRockGameplayTagFloatBatchEdit
+{
+	explicit FRockGameplayTagFloatBatchEdit(FRockGameplayTagFloatContainer& InContainer)
+		: Container(InContainer)
+	{
+	}
+
+	~FRockGameplayTagFloatBatchEdit()
+	{
+		Commit();
+	}
+
+	FRockGameplayTagFloatBatchEdit(const FRockGameplayTagFloatBatchEdit&) = delete;
+	FRockGameplayTagFloatBatchEdit& operator=(const FRockGameplayTagFloatBatchEdit&) = delete;
+
+	// Same rules as the matching FRockGameplayTagFloatContainer functions
+	void AddFloat(FGameplayTag Tag, float FloatValue);
+	void SetFloat(FGameplayTag Tag, float FloatValue);
+	void SubtractFloat(FGameplayTag Tag, float FloatValue);
+	void RemoveTag(FGameplayTag Tag);
+
+	bool IsEmpty() const { return Edits.IsEmpty(); }
+
+	// Applies every pending change to the container, the batch can be reused afterward
+	void Commit();
+
+private:
+	struct FTagEdit
+	{
+		FGameplayTag	Tag;
+		// Value of the tag after the changes so far, 0 if the tag is (or will be) removed
+		float			Value = 0.f;
+	};
+
+	FTagEdit& FindOrAddEdit(FGameplayTag Tag);
+
+	FRockGameplayTagFloatContainer& Container;
+	TArray<FTagEdit, TInlineAllocator<8>> Edits;
 };
 
 template<>
@@ -5,11 +5,17 @@
 
 #include "CoreMinimal.h"
 #include "AbilitySystemGlobals.h"
+#include "AbilitySystem/Attributes/RockAttributeSetInitter.h"
+#include "AbilitySystem/Containers/RockGameplayTagFloatContainer.h"
+#include "Containers/Ticker.h"
 #include "RockAbilitySystemGlobals.generated.h"
 
 struct FRockAttributeChangeInfo;
+class FRockAttributeChangeInfoHandle;
+class FRockAttributeChangeInfoPool;
 struct FRockAttributeSetInitter;
 struct FRockAttributeInitializationKey;
+struct FRockAttributeInitializationRequest;
 /**
  * 
  */
@@ -28,9 +34,13 @@ public:
 	//~UAbilitySystemGlobals interface
 	virtual FGameplayEffectContext* AllocGameplayEffectContext() const override;
 	virtual void AllocAttributeSetInitter() override;
+	virtual void InitAttributeDefaults() override;
 	//~End of UAbilitySystemGlobals interface
 	virtual TSharedPtr<FRockAttributeChangeInfo> AllocRockAttributeChangeInfo() const;
 
+	/** Same as AllocRockAttributeChangeInfo, taking the info from a pool so it doesn't allocate once the pool is warm */
+	virtual FRockAttributeChangeInfoHandle AllocPooledRockAttributeChangeInfo() const;
+
 	virtual FRockAttributeSetInitter* GetRockAttributeSetInitter() const;
 	virtual void ReloadAttributeDefaults() override;
 
@@ -40,4 +50,122 @@ public:
 	virtual void ApplyAttributeSetDefaults(UAbilitySystemComponent* AbilitySystemComponent, FGameplayAttribute& InAttribute, const FRockAttributeInitializationKey& Key, int32 Level) const;
 	virtual TArray<float> GetAttributeSetValues(UClass* AttributeSetClass, FProperty* AttributeProperty, const FRockAttributeInitializationKey& Key) const;
 	// ~ End FAttributeSetInitter Interface
+
+	/** Same as GetAttributeSetValues without copying, for UI and tools that query many values per frame. Valid until the defaults are reloaded */
+	TConstArrayView<float> GetAttributeSetValuesView(const UClass* AttributeSetClass, const FProperty* AttributeProperty, const FRockAttributeInitializationKey& Key) const;
+
+	/** Initializes attribute defaults at a fractional level, interpolating between the preloaded samples */
+	virtual void InitAttributeSetDefaultsInterpolated(UAbilitySystemComponent* AbilitySystemComponent, const FRockAttributeInitializationKey& Key, float Level, bool bInitialInit) const;
+
+	/** Updates the attribute defaults of a leveled up (or down) ASC, only writing the attributes whose default differs between the levels */
+	virtual void ApplyLevelTransition(UAbilitySystemComponent* AbilitySystemComponent, const FRockAttributeInitializationKey& Key, int32 FromLevel, int32 ToLevel) const;
+
+	/**
+	 * Initializes the attribute defaults of many ASCs at once, e.g. a wave of spawns.
+	 * Every distinct key is resolved once, the requests are then initialized one after another.
+	 */
+	virtual void InitAttributeSetDefaultsBatch(TConstArrayView<FRockAttributeInitializationRequest> Requests, bool bInitialInit) const;
+
+	/**
+	 * Reloads only the attribute default groups fed by the changed curve tables, instead of every group like ReloadAttributeDefaults.
+	 * With bPushToLiveASCs the base values whose default changed are written to every tracked ASC of those groups, a few ASCs
+	 * per frame. Attributes whose default didn't change keep their live values.
+	 */
+	virtual void ReloadAttributeDefaultsForTables(const TArray<UCurveTable*>& ChangedTables, bool bPushToLiveASCs);
+
+	/** Forgets an ASC tracked for pushing reloaded defaults, called when the ASC stops playing */
+	void UntrackAttributeDefaultsTarget(const UAbilitySystemComponent* AbilitySystemComponent);
+
+	/** Returns the wire encoding of FRockGameplayTagFloatContainer values of Tag */
+	const FRockTagFloatQuantization& GetTagFloatNetQuantization(FGameplayTag Tag) const
+	{
+		const FRockTagFloatQuantization* TagQuantization = TagFloatNetQuantizationByTag.Find(Tag);
+		return TagQuantization ? *TagQuantization : TagFloatNetQuantization;
+	}
+
+protected:
+	/** Allow attribute default curves with sparse or fractional keys. They are sampled into lookup tables at preload instead of requiring a key per level */
+	UPROPERTY(Config)
+	bool bInterpolateAttributeDefaults = false;
+
+	/** Number of lookup table samples per level when bInterpolateAttributeDefaults is set. Higher values follow non-linear curves more closely */
+	UPROPERTY(Config, meta = (ClampMin = 1))
+	int32 AttributeDefaultsSamplesPerLevel = 1;
+
+	/**
+	 * Save the preloaded attribute defaults to a binary cache on first run and map it on later runs instead of parsing the curve tables.
+	 * The cache is rebuilt whenever the curve tables, the build or the interpolation settings change. Never used in the editor.
+	 */
+	UPROPERTY(Config)
+	bool bCacheAttributeDefaults = false;
+
+	/** Number of released FRockAttributeChangeInfo kept for reuse by AllocPooledRockAttributeChangeInfo. 0 allocates a new info every time */
+	UPROPERTY(Config, meta = (ClampMin = 0))
+	int32 AttributeChangeInfoPoolSize = 256;
+
+	/**
+	 * Write attribute defaults straight into the sets of ASCs that never had a gameplay effect applied, instead of going through the ASC.
+	 * Skips the Pre/PostAttributeChange callbacks of the sets for those writes.
+	 */
+	UPROPERTY(Config)
+	bool bInitAttributeDefaultsDirectly = false;
+
+	/** Identifies the curve tables and settings the attribute defaults are built from. Loads the tables to hash their curves */
+	uint64 GetAttributeDefaultsSourceStamp() const;
+
+	FString GetAttributeDefaultsCacheFilename() const;
+
+	/** Remember the group and level every ASC was last initialized with, so reloaded defaults can be pushed to live ASCs */
+	UPROPERTY(Config)
+	bool bTrackAttributeDefaultsTargets = false;
+
+	/** Maximum number of ASCs that get reloaded defaults pushed to them per frame */
+	UPROPERTY(Config, meta = (ClampMin = 1))
+	int32 AttributeDefaultsPushBudgetPerFrame = 32;
+
+	/** How the values of every FRockGameplayTagFloatContainer are replicated. Full floats unless NumBits is set */
+	UPROPERTY(Config)
+	FRockTagFloatQuantization TagFloatNetQuantization;
+
+	/** Overrides TagFloatNetQuantization for exact tag matches */
+	UPROPERTY(Config)
+	TMap<FGameplayTag, FRockTagFloatQuantization> TagFloatNetQuantizationByTag;
+
+private:
+	/**
+	 * Returns the group index of the key, resolved from its group name once and cached on the key until the defaults are rebuilt.
+	 * Without bAllowFallback keys whose group doesn't exist return INDEX_NONE instead of the "Default" group.
+	 */
+	int32 ResolveAttributeInitGroup(const FRockAttributeInitializationKey& Key, bool bAllowFallback) const;
+
+	/** Fills GlobalAttributeDefaultsTables if it wasn't filled yet, defaults from the cache don't need it */
+	void LoadAttributeDefaultsTables();
+
+	void TrackAttributeDefaultsTarget(UAbilitySystemComponent* AbilitySystemComponent, FName GroupName, float Level) const;
+
+	bool TickAttributeDefaultsPush(float DeltaTime);
+
+	struct FAttributeDefaultsTarget
+	{
+		FName	GroupName;
+		float	Level = 1.f;
+	};
+
+	// Group, level and attribute set class of a tracked set
+	using FAttributeDefaultsSetKey = TTuple<FName, float, TObjectKey<UClass>>;
+
+	/** Adds the defaults of every set of every tracked ASC in Groups to OutDefaults, keyed by group, level and set class */
+	void GatherTrackedAttributeDefaults(const TArray<FName>& Groups, TMap<FAttributeDefaultsSetKey, TArray<FRockAttributeDefaultValue>>& OutDefaults) const;
+
+	void PruneAttributeDefaultsTargets() const;
+
+	mutable TSharedPtr<FRockAttributeChangeInfoPool, ESPMode::ThreadSafe> AttributeChangeInfoPool;
+
+	mutable TMap<TWeakObjectPtr<UAbilitySystemComponent>, FAttributeDefaultsTarget> AttributeDefaultsTargets;
+	// AttributeDefaultsTargets is pruned of destroyed ASCs whenever it grows to this size
+	mutable int32 AttributeDefaultsTargetsPruneSize = 64;
+	TArray<TWeakObjectPtr<UAbilitySystemComponent>> PendingAttributeDefaultsPushes;
+	// Base values whose default changed in the last reloads, waiting to be pushed to the ASCs in PendingAttributeDefaultsPushes
+	TMap<FAttributeDefaultsSetKey, TArray<FRockAttributeDefaultValue>> PendingAttributeDefaultChanges;
+	FTSTicker::FDelegateHandle AttributeDefaultsPushTickerHandle;
 };
@@ -21,6 +21,20 @@ public:
 	
 	FRockGameplayEffectContext() : FGameplayEffectContext() {}
 	FRockGameplayEffectContext(const FGameplayEffectContext& Other) : FGameplayEffectContext(Other) {}
+
+	/**
+	 * Heap allocated contexts (AllocGameplayEffectContext, Duplicate) come from a thread-safe slab allocator instead of the
+	 * general heap. Derived contexts of a different size, and contexts past the slab reservation, fall back to the regular
+	 * heap. Delete tells the two apart by address, so contexts allocated elsewhere can be deleted through here too.
+	 */
+	static void* operator new(size_t Size);
+	static void operator delete(void* Ptr, size_t Size);
+	// Placement new is still used by the struct ops, declaring the operators above hides the global one
+	static void* operator new(size_t Size, void* Placement) { return Placement; }
+	static void operator delete(void* Ptr, void* Placement) {}
+
+	/** Largest number of slab allocated contexts alive at once since startup */
+	static int32 GetSlabHighWaterMark();
 	
 	/** Returns the wrapped FRockGameplayEffectContext from the handle, or nullptr if it doesn't exist or is the wrong type */
 	static FRockGameplayEffectContext* ExtractEffectContext(struct FGameplayEffectContextHandle Handle);
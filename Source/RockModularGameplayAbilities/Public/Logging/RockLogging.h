@@ -4,10 +4,12 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
 #include "UObject/Object.h"
 #include "RockLogging.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogRockAbilitySystem, Display, All);
+DECLARE_STATS_GROUP(TEXT("RockAbilitySystem"), STATGROUP_RockAbilitySystem, STATCAT_Advanced);
 
 /**
  * 